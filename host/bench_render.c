@@ -0,0 +1,291 @@
+// Rendering benchmark: host time per drawing primitive, plus the bus cost
+// (bytes and transactions) the mock panel sees per frame and per slide.
+// With --check, exits non-zero if bus cost goes over the budgets below, so
+// CI catches regressions; host timings are reported only.
+#include "firmware.h"
+#include <time.h>
+
+// Bus budgets for --check (bytes include each transaction's address byte)
+#define BUDGET_INIT_BYTES 32
+#define BUDGET_INIT_TRANSACTIONS 1
+#define BUDGET_FIRST_FRAME_BYTES 1050
+#define BUDGET_FIRST_FRAME_TRANSACTIONS 1
+#define BUDGET_TURN_CHANGE_BYTES 40
+#define BUDGET_TURN_CHANGE_TRANSACTIONS 1
+#if DISPLAY_HW_SCROLL
+// A scroll command and the incoming column per column, at the panel's pace
+#define BUDGET_TRANSITION_BYTES 4000
+#define BUDGET_TRANSITION_TRANSACTIONS (2 * SLIDE_FRAMES + 2)
+#define BUDGET_TRANSITION_MS (SLIDE_FRAMES * DISPLAY_SCROLL_COLUMN_MS + 150)
+#else
+#define BUDGET_TRANSITION_BYTES 7050
+#define BUDGET_TRANSITION_TRANSACTIONS 9
+#define BUDGET_TRANSITION_MS 450  // Down to 100 kHz, where one frame outlasts two ticks
+#endif
+#define BUDGET_MIRROR_OVERHEAD_PCT 10  // Second panel on the other controller
+#define BUDGET_BOOT_MS 40  // Reset to the first frame lit, at 400 kHz
+
+static int failures;
+static bool check;
+static double bench_ns;  // Result of the last BENCH()
+
+static uint64_t host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#define BENCH(label, iterations, body)                                      \
+    do {                                                                    \
+        uint64_t start_ns = host_ns();                                      \
+        for (int bench_i = 0; bench_i < (iterations); bench_i++) {          \
+            body;                                                           \
+        }                                                                   \
+        bench_ns = (double)(host_ns() - start_ns) / (iterations);           \
+        printf("%-36s %10.1f ns\n", label, bench_ns);                       \
+    } while (0)
+
+static void report_bus(const char *label, const mock_bus_stats_t *s, uint32_t budget_bytes,
+                       uint32_t budget_transactions) {
+    printf("%-36s %6u bytes %4u transactions (%u data)\n", label, s->bytes, s->transactions, s->data_bytes);
+    if (check && (s->bytes > budget_bytes || s->transactions > budget_transactions)) {
+        printf("  over budget: %u bytes / %u transactions allowed\n", budget_bytes, budget_transactions);
+        failures++;
+    }
+}
+
+static void bench_primitives(void) {
+    static uint8_t pixels[SSD1306_BUFFER_SIZE];
+    ssd1306_sprite_t sprite;
+
+    firmware_reset();
+    draw_content(names[1], 3, 0, true);
+    ssd1306_sprite_capture(&display, &sprite, pixels, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT / 8);
+
+    printf("-- primitives (host time per call)\n");
+    BENCH("fill_rect 128x64", 20000,
+          ssd1306_fill_rect(&display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, bench_i & 1));
+    BENCH("fill_rect 6x6 dot", 200000,
+          ssd1306_fill_rect(&display, 60, 49, 6, 6, bench_i & 1));
+    BENCH("draw_hline 112", 200000,
+          ssd1306_draw_hline(&display, 8, 10, 112, bench_i & 1));
+    BENCH("draw_vline 60", 200000,
+          ssd1306_draw_vline(&display, 2, 2, 60, bench_i & 1));
+    BENCH("draw_line diagonal", 100000,
+          ssd1306_draw_line(&display, 0, 0, 127, 63, bench_i & 1));
+    BENCH("draw_rect border", 100000,
+          ssd1306_draw_rect(&display, 2, 2, 124, 60, bench_i & 1));
+    BENCH("draw_string 6 chars", 100000,
+          ssd1306_draw_string(&display, 10, 20, "Adalie", bench_i & 1));
+    BENCH("draw_string_scaled x3 6 chars", 50000,
+          ssd1306_draw_string_scaled(&display, 10, 16, "Adalie", 3, bench_i & 1));
+    BENCH("blit 128x64 sprite, y=3", 50000,
+          ssd1306_blit(&display, &sprite, 0, 3, SSD1306_BLIT_XOR));
+    BENCH("draw_content", 50000,
+          draw_content(names[bench_i & 1], 1 + bench_i % 3, 0, false));
+    BENCH("draw_content half off-screen", 50000,
+          draw_content(names[bench_i & 1], 1 + bench_i % 3, DISPLAY_WIDTH / 2, false));
+    BENCH("draw_content off-screen", 50000,
+          draw_content(names[bench_i & 1], 1 + bench_i % 3, DISPLAY_WIDTH, false));
+    BENCH("render_screen (rasterize)", 20000,
+          render_screen(bench_i & 1, 1 + bench_i % 3));
+    BENCH("draw_screen (flash frame + flush)", 20000,
+          draw_screen(bench_i & 1, 1 + bench_i % 3));
+}
+
+static const uint8_t *slide_frame(int16_t step) {
+    return anim_slide_data + anim_slide_index[0][1][step];
+}
+
+static void decode_slide(uint16_t *chunk) {
+    for (int16_t step = 0; step < ANIM_SLIDE_STEPS; step++) {
+        const uint8_t *frame = slide_frame(step);
+        if (frame[2] == ANIM_NO_CHANGE) continue;
+
+        anim_decoder_t dec;
+        anim_decoder_init(&dec, frame + 4);
+        uint32_t left = (frame[1] - frame[0] + 1) * (frame[3] - frame[2] + 1);
+        while (left) {
+            uint16_t n = left < SSD1306_STREAM_CHUNK ? left : SSD1306_STREAM_CHUNK;
+            left -= anim_decode(&dec, chunk, n);
+        }
+    }
+}
+
+static void stream_slide(void) {
+    for (int16_t step = 0; step < ANIM_SLIDE_STEPS; step++) {
+        anim_stream_frame(&display, slide_frame(step));
+    }
+}
+
+// Compressed slide decode against the raw path that stages the buffer
+static void bench_anim(void) {
+    static uint16_t chunk[SSD1306_STREAM_CHUNK];
+    uint32_t slide_bytes = 0;
+    for (int16_t step = 0; step < ANIM_SLIDE_STEPS; step++) {
+        const uint8_t *frame = slide_frame(step);
+        if (frame[2] == ANIM_NO_CHANGE) continue;
+        slide_bytes += (frame[1] - frame[0] + 1) * (frame[3] - frame[2] + 1);
+    }
+
+    printf("-- compressed slides: %zu bytes in flash for %u raw (%.1fx)\n",
+           sizeof(anim_slide_data), ANIM_SLIDE_RAW_BYTES,
+           (double)ANIM_SLIDE_RAW_BYTES / sizeof(anim_slide_data));
+
+    firmware_reset();
+    BENCH("anim_decode one slide", 5000, decode_slide(chunk));
+    printf("%-36s %10.2f ns/byte (%u bytes)\n", "  decode only", bench_ns / slide_bytes, slide_bytes);
+    BENCH("anim_stream_frame one slide", 2000, stream_slide());
+    printf("%-36s %10.2f ns/byte\n", "  decode + stage + mock bus", bench_ns / slide_bytes);
+    BENCH("ssd1306_display full frame", 20000,
+          { ssd1306_invalidate(&display); ssd1306_display(&display); });
+    printf("%-36s %10.2f ns/byte\n", "  memcpy stage + mock bus", bench_ns / SSD1306_BUFFER_SIZE);
+}
+
+static void bench_bus(void) {
+    printf("-- bus cost\n");
+
+    // Reset to the saved screen on the panel: power-up wait, init, one
+    // full frame and the display-on
+    mock_reset();
+    perf_reset();
+    firmware_buses();
+    mock_set_bus_baudrate(I2C_BAUDRATE);
+    renderer_show(0, 1);
+    render_boot();
+    mock_set_bus_baudrate(0);
+    printf("%-36s %6lu us (%u transactions)\n", "boot to first frame", (unsigned long)perf_boot_us,
+           mock_bus_stats.transactions);
+    if (perf_boot_us > BUDGET_BOOT_MS * 1000) {
+        printf("  over budget: %u ms\n", BUDGET_BOOT_MS);
+        failures++;
+    }
+
+    firmware_reset();
+    report_bus("init", &mock_bus_stats, BUDGET_INIT_BYTES, BUDGET_INIT_TRANSACTIONS);
+
+    mock_bus_stats = (mock_bus_stats_t){0};
+    draw_screen(0, 1);
+    ssd1306_wait(&display);
+    report_bus("first frame", &mock_bus_stats, BUDGET_FIRST_FRAME_BYTES, BUDGET_FIRST_FRAME_TRANSACTIONS);
+
+    mock_bus_stats = (mock_bus_stats_t){0};
+    draw_screen(0, 2);
+    ssd1306_wait(&display);
+    report_bus("turn change (defer)", &mock_bus_stats, BUDGET_TURN_CHANGE_BYTES,
+               BUDGET_TURN_CHANGE_TRANSACTIONS);
+
+    mock_bus_stats = (mock_bus_stats_t){0};
+    uint64_t start_us = time_us_64();
+    animate_transition(0, 1, 1);
+    ssd1306_wait(&display);
+    report_bus("transition (slide + final frame)", &mock_bus_stats, BUDGET_TRANSITION_BYTES,
+               BUDGET_TRANSITION_TRANSACTIONS);
+    printf("%-36s %6llu ms (virtual, bus time not modelled)\n", "transition duration",
+           (unsigned long long)(time_us_64() - start_us) / 1000);
+
+    // The slide keeps its wall-clock length on a slower bus by dropping
+    // frames; only the final frame's flush comes on top
+    static const uint32_t bauds[] = {100000, 400000, 1000000};
+    for (size_t i = 0; i < count_of(bauds); i++) {
+        firmware_reset();
+        draw_screen(0, 1);
+        ssd1306_wait(&display);
+        perf_reset();
+        firmware_bus_baudrate(bauds[i]);
+
+        start_us = time_us_64();
+        animate_transition(0, 1, 1);
+        ssd1306_wait(&display);
+        uint64_t ms = (time_us_64() - start_us) / 1000;
+
+        char label[48];
+        snprintf(label, sizeof(label), "transition at %lu kHz", (unsigned long)(bauds[i] / 1000));
+        printf("%-36s %6llu ms (%lu frames, %lu dropped)\n", label, (unsigned long long)ms,
+               (unsigned long)perf_anim_frames, (unsigned long)perf_anim_dropped);
+        if (ms > BUDGET_TRANSITION_MS) {
+            printf("  over budget: %u ms\n", BUDGET_TRANSITION_MS);
+            failures++;
+        }
+        if (perf_faults[PERF_FAULT_TIMEOUT]) {
+            printf("  %lu flushes timed out\n", (unsigned long)perf_faults[PERF_FAULT_TIMEOUT]);
+            failures++;
+        }
+    }
+    mock_set_bus_baudrate(0);
+
+    // A mirrored second panel: on the other controller its copy goes out
+    // alongside the first, on the same one (at 0x3D) after it
+    static const struct {
+        const char *label;
+        i2c_inst_t *port;
+        uint8_t addr;
+    } mirrors[] = {
+#if DISPLAY_MIRROR
+        {"first frame, mirror as configured", NULL, 0},
+#else
+        {"first frame, one panel", NULL, 0},
+#endif
+        {"  mirrored on i2c1", i2c1, 0x3C},
+        {"  mirrored on i2c0 at 0x3D", i2c0, 0x3D},
+    };
+    uint64_t single_us = 0;
+    for (size_t i = 0; i < count_of(mirrors); i++) {
+        if (mirrors[i].port) {
+            firmware_reset_mirror(mirrors[i].port, mirrors[i].addr);
+        } else {
+            firmware_reset();
+        }
+        mock_bus_stats = (mock_bus_stats_t){0};
+        mock_bus_stats2 = (mock_bus_stats_t){0};
+        mock_set_bus_baudrate(I2C_BAUDRATE);
+        start_us = time_us_64();
+        draw_screen(0, 1);
+        ssd1306_wait(&display);
+        uint64_t us = time_us_64() - start_us;
+        mock_set_bus_baudrate(0);
+
+        printf("%-36s %6llu us (%u bytes)\n", mirrors[i].label, (unsigned long long)us,
+               mock_bus_stats.bytes + mock_bus_stats2.bytes);
+        if (!mirrors[i].port) {
+            single_us = us;
+        } else if (mirrors[i].port != I2C_PORT && us * 100 > single_us * (100 + BUDGET_MIRROR_OVERHEAD_PCT)) {
+            printf("  over budget: %u%% over one panel\n", BUDGET_MIRROR_OVERHEAD_PCT);
+            failures++;
+        }
+    }
+
+    // The same on SPI, where a full frame takes about 1 ms on the wire
+    firmware_reset_spi();
+    mock_set_bus_baudrate(SPI_BAUDRATE);
+    start_us = time_us_64();
+    draw_screen(0, 1);
+    ssd1306_wait(&display);
+    printf("%-36s %6llu us\n", "first frame on SPI", (unsigned long long)(time_us_64() - start_us));
+
+    start_us = time_us_64();
+    animate_transition(0, 1, 1);
+    ssd1306_wait(&display);
+    printf("%-36s %6llu ms (%lu frames, %lu dropped)\n", "transition on SPI",
+           (unsigned long long)(time_us_64() - start_us) / 1000,
+           (unsigned long)perf_anim_frames, (unsigned long)perf_anim_dropped);
+    mock_set_bus_baudrate(0);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) check = true;
+    }
+
+    if (!check) {
+        bench_primitives();
+        bench_anim();
+    }
+    bench_bus();
+
+    if (failures) {
+        printf("%d budget(s) exceeded\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef HOST_FIRMWARE_H
+#define HOST_FIRMWARE_H
+
+// Pull the firmware's display and UI code into a host program the same way
+// src/main.c does (single translation unit), on top of the mock HAL
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "config.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "perf.c"
+#include "trace.c"
+#include "storage.c"
+#include "journal.c"
+#include "ssd1306.c"
+#include "ssd1306_i2c.c"
+#include "ssd1306_spi.c"
+#include "anim.c"
+#include "buttons.c"
+#include "renderer.c"
+#include "power.c"
+
+// The bus controllers and pins as main.c sets them up, with the mirror
+// panel (if configured) wired where render_display_init() looks for it
+static inline void firmware_buses(void) {
+#if DISPLAY_MIRROR
+    mock_i2c_panel2(i2c_hw_index(MIRROR_I2C_PORT), MIRROR_I2C_ADDR);
+#endif
+    i2c_init(I2C_PORT, I2C_BAUDRATE);
+    i2c_init(MIRROR_I2C_PORT, I2C_BAUDRATE);
+    spi_init(SPI_PORT, SPI_BAUDRATE);
+    gpio_pull_up(I2C_SDA_PIN);
+    gpio_pull_up(I2C_SCL_PIN);
+    gpio_pull_up(MIRROR_I2C_SDA_PIN);
+    gpio_pull_up(MIRROR_I2C_SCL_PIN);
+}
+
+// Give the mock's wires `baudrate` and have the display's deadlines (both
+// panels' when mirrored) follow it; firmware_reset() puts them back
+static inline void firmware_bus_baudrate(uint32_t baudrate) {
+    mock_set_bus_baudrate(baudrate);
+    display_bus.bus.baudrate = baudrate;
+#if DISPLAY_MIRROR
+    mirror_bus.bus.baudrate = baudrate;
+#endif
+}
+
+// Fresh mock hardware and an initialized display
+static inline void firmware_reset(void) {
+    mock_reset();
+    perf_reset();
+    firmware_buses();
+    render_display_init();
+}
+
+// The same with the panel on SPI, whatever config.h selects
+static ssd1306_spi_bus_t firmware_spi_bus;
+
+static inline void firmware_reset_spi(void) {
+    mock_reset();
+    perf_reset();
+    firmware_buses();
+    mock_spi_panel_pins(SPI_CS_PIN, SPI_DC_PIN);
+    ssd1306_spi_bus_init(&firmware_spi_bus, SPI_PORT, SPI_CS_PIN, SPI_DC_PIN, SPI_RESET_PIN);
+    ssd1306_init(&display, &firmware_spi_bus.bus);
+}
+
+// The same with a second panel mirroring the first, on controller `port`
+// at `addr`
+static ssd1306_i2c_bus_t firmware_i2c_bus;
+static ssd1306_i2c_bus_t firmware_mirror_bus;
+
+static inline void firmware_reset_mirror(i2c_inst_t *port, uint8_t addr) {
+    mock_reset();
+    perf_reset();
+    firmware_buses();
+    mock_i2c_panel2(i2c_hw_index(port), addr);
+    ssd1306_i2c_bus_init(&firmware_i2c_bus, I2C_PORT, DISPLAY_I2C_ADDR, I2C_SDA_PIN, I2C_SCL_PIN, I2C_BAUDRATE);
+    bool shared = port == I2C_PORT;
+    ssd1306_i2c_bus_init(&firmware_mirror_bus, port, addr, shared ? I2C_SDA_PIN : MIRROR_I2C_SDA_PIN,
+                         shared ? I2C_SCL_PIN : MIRROR_I2C_SCL_PIN, I2C_BAUDRATE);
+    ssd1306_attach(&display, &firmware_i2c_bus.bus);
+    ssd1306_add_panel(&display, &firmware_mirror_bus.bus);
+    ssd1306_configure(&display, true);
+}
+
+#endif // HOST_FIRMWARE_H
@@ -0,0 +1,40 @@
+#ifndef MOCK_HARDWARE_CLOCKS_H
+#define MOCK_HARDWARE_CLOCKS_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MHZ 1000000
+
+typedef enum {
+    clk_gpout0,
+    clk_gpout1,
+    clk_gpout2,
+    clk_gpout3,
+    clk_ref,
+    clk_sys,
+    clk_peri,
+    clk_usb,
+    clk_adc,
+    clk_rtc,
+} clock_num_t;
+
+#define CLOCKS_CLK_REF_CTRL_SRC_VALUE_XOSC_CLKSRC 0x2
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF 0x0
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS 0x0
+
+// Only clk_sys is modelled: it sets the I2C/SPI dividers
+bool clock_configure(clock_num_t clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq);
+void clock_stop(clock_num_t clk_index);
+uint32_t clock_get_hz(clock_num_t clk_index);
+// Back to the boot-time clocks (clk_sys at 125 MHz), as after a dormant wake
+void runtime_init_clocks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_CLOCKS_H
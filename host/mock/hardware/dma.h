@@ -0,0 +1,53 @@
+#ifndef MOCK_HARDWARE_DMA_H
+#define MOCK_HARDWARE_DMA_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    uint dreq;
+} dma_channel_config;
+
+#define NUM_DMA_CHANNELS 12
+
+// Only the registers the firmware reads back
+typedef struct {
+    volatile uintptr_t read_addr;
+} dma_channel_hw_t;
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel);
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+// Completion interrupts on DMA_IRQ_1
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq1_status(uint channel);
+void dma_channel_acknowledge_irq1(uint channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_DMA_H
@@ -0,0 +1,21 @@
+#ifndef MOCK_HARDWARE_FLASH_H
+#define MOCK_HARDWARE_FLASH_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_FLASH_H
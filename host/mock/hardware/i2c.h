@@ -0,0 +1,51 @@
+#ifndef MOCK_HARDWARE_I2C_H
+#define MOCK_HARDWARE_I2C_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Only the registers the display driver touches
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t intr_stat;
+    volatile uint32_t intr_mask;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t clr_stop_det;
+} i2c_hw_t;
+
+typedef struct i2c_inst {
+    i2c_hw_t *hw;
+    uint index;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS 0x00000200u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS 0x00000200u
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us);
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+static inline uint i2c_hw_index(i2c_inst_t *i2c) { return i2c->index; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { return i2c->index * 2 + (is_tx ? 0 : 1); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_I2C_H
@@ -0,0 +1,22 @@
+#ifndef MOCK_HARDWARE_IRQ_H
+#define MOCK_HARDWARE_IRQ_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DMA_IRQ_1 12
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+
+typedef void (*irq_handler_t)(void);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_IRQ_H
@@ -0,0 +1,20 @@
+#ifndef MOCK_HARDWARE_PLL_H
+#define MOCK_HARDWARE_PLL_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned PLL;
+#define pll_sys 0u
+#define pll_usb 1u
+
+void pll_deinit(PLL pll);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_PLL_H
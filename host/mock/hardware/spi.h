@@ -0,0 +1,37 @@
+#ifndef MOCK_HARDWARE_SPI_H
+#define MOCK_HARDWARE_SPI_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Only the registers the display driver touches
+typedef struct {
+    volatile uint32_t dr;
+} spi_hw_t;
+
+typedef struct spi_inst {
+    spi_hw_t *hw;
+    uint index;
+} spi_inst_t;
+
+extern spi_inst_t spi0_inst;
+#define spi0 (&spi0_inst)
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+uint spi_get_baudrate(const spi_inst_t *spi);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+bool spi_is_busy(spi_inst_t *spi);
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return spi->hw; }
+static inline uint spi_get_index(spi_inst_t *spi) { return spi->index; }
+static inline uint spi_get_dreq(spi_inst_t *spi, bool is_tx) { return 16 + spi->index * 2 + (is_tx ? 0 : 1); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_SPI_H
@@ -0,0 +1,19 @@
+#ifndef MOCK_HARDWARE_XOSC_H
+#define MOCK_HARDWARE_XOSC_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XOSC_MHZ 12
+
+// Returns at once: see mock_dormant_wake_pin()
+void xosc_dormant(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HARDWARE_XOSC_H
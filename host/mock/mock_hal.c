@@ -0,0 +1,834 @@
+#include "mock_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "pico/stdio_usb.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/xosc.h"
+
+mock_panel_t mock_panel;
+mock_panel_t mock_panel2;
+mock_bus_stats_t mock_bus_stats;
+mock_bus_stats_t mock_bus_stats2;
+uint8_t mock_flash[PICO_FLASH_SIZE_BYTES];
+
+static mock_frame_hook_t frame_hook;
+static uint64_t now_us;
+static uint32_t bus_baudrate;
+static uint32_t sys_clock_khz = 125000;
+static bool gpio_levels[30];
+
+// ---------------------------------------------------------------------------
+// SSD1306 model
+
+// Argument bytes that follow each multi-byte command
+static uint8_t panel_cmd_args(uint8_t op) {
+    switch (op) {
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xAD: case 0xD3:
+        case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x26: case 0x27:
+            return 6;
+        case 0x2C: case 0x2D:
+            return 7;
+        default:
+            return 0;
+    }
+}
+
+static void panel_content_scroll(mock_panel_t *p, bool left, uint8_t page0, uint8_t page1, uint8_t x0, uint8_t x1) {
+    for (uint8_t page = page0; page <= page1 && page < MOCK_PANEL_PAGES; page++) {
+        uint8_t *row = p->gddram + page * MOCK_PANEL_WIDTH;
+        if (left) {
+            uint8_t wrapped = row[x0];
+            memmove(row + x0, row + x0 + 1, x1 - x0);
+            row[x1] = wrapped;
+        } else {
+            uint8_t wrapped = row[x1];
+            memmove(row + x0 + 1, row + x0, x1 - x0);
+            row[x0] = wrapped;
+        }
+    }
+}
+
+static void panel_run_cmd(mock_panel_t *p, const uint8_t *c) {
+    switch (c[0]) {
+        case 0x21:
+            p->col_start = p->col = c[1];
+            p->col_end = c[2];
+            break;
+        case 0x22:
+            p->page_start = p->page = c[1];
+            p->page_end = c[2];
+            break;
+        case 0x81: p->contrast = c[1]; break;
+        case 0xAE: p->display_on = false; break;
+        case 0xAF: p->display_on = true; break;
+        case 0x2E: p->scrolling = false; break;
+        case 0x2F: p->scrolling = true; break;
+        case 0x2C:
+        case 0x2D:
+            panel_content_scroll(p, c[0] == 0x2D, c[2], c[4], c[6], c[7]);
+            break;
+        default:
+            break;
+    }
+}
+
+static mock_bus_stats_t *panel_stats(const mock_panel_t *p) {
+    return p == &mock_panel2 ? &mock_bus_stats2 : &mock_bus_stats;
+}
+
+static void panel_cmd_byte(mock_panel_t *p, uint8_t b) {
+    p->cmd[p->cmd_len++] = b;
+    if (p->cmd_len > panel_cmd_args(p->cmd[0])) {
+        panel_run_cmd(p, p->cmd);
+        p->cmd_len = 0;
+    }
+    panel_stats(p)->cmd_bytes++;
+}
+
+static void panel_data_byte(mock_panel_t *p, uint8_t b) {
+    if (p->page < MOCK_PANEL_PAGES && p->col < MOCK_PANEL_WIDTH) {
+        p->gddram[p->page * MOCK_PANEL_WIDTH + p->col] = b;
+    }
+
+    // Horizontal addressing: wrap at the end of the column window, then
+    // at the end of the page window
+    if (p->col >= p->col_end) {
+        p->col = p->col_start;
+        p->page = p->page >= p->page_end ? p->page_start : p->page + 1;
+    } else {
+        p->col++;
+    }
+    panel_stats(p)->data_bytes++;
+}
+
+// One I2C write: a sequence of control bytes (Co, D/C#) and payload.
+// Returns its time on the wire.
+static uint64_t panel_transaction(mock_panel_t *p, const uint8_t *bytes, size_t len) {
+    bool had_data = false;
+    size_t i = 0;
+
+    mock_bus_stats_t *stats = panel_stats(p);
+    stats->transactions++;
+    stats->bytes += len + 1;
+
+    while (i < len) {
+        uint8_t ctrl = bytes[i++];
+        bool single = ctrl & 0x80;
+        bool data = ctrl & 0x40;
+        size_t end = single ? (i < len ? i + 1 : i) : len;
+
+        for (; i < end; i++) {
+            if (data) {
+                panel_data_byte(p, bytes[i]);
+                had_data = true;
+            } else {
+                panel_cmd_byte(p, bytes[i]);
+            }
+        }
+    }
+
+    if (had_data && frame_hook) {
+        frame_hook(p);
+    }
+
+    // 9 clocks per byte (8 data + ACK) on a modelled bus
+    return bus_baudrate ? (len + 1) * 9 * 1000000ull / bus_baudrate : 0;
+}
+
+// SPI: the panel listens while CS is low, D/C picks command or data
+static int spi_cs_pin = -1;
+static int spi_dc_pin = -1;
+static bool spi_selected;
+static bool spi_had_data;
+static uint32_t spi_txn_bytes;
+
+static void panel_spi_byte(uint8_t b) {
+    if (!spi_selected) return;
+    spi_txn_bytes++;
+    mock_bus_stats.bytes++;
+    if (gpio_levels[spi_dc_pin]) {
+        panel_data_byte(&mock_panel, b);
+        spi_had_data = true;
+    } else {
+        panel_cmd_byte(&mock_panel, b);
+    }
+}
+
+static void panel_spi_select(bool selected) {
+    if (selected == spi_selected) return;
+    spi_selected = selected;
+    if (selected) {
+        mock_bus_stats.transactions++;
+        spi_txn_bytes = 0;
+        spi_had_data = false;
+        return;
+    }
+
+    if (spi_had_data && frame_hook) {
+        frame_hook(&mock_panel);
+    }
+    if (bus_baudrate) {
+        mock_advance_us(spi_txn_bytes * 8 * 1000000ull / bus_baudrate);
+    }
+}
+
+void mock_spi_panel_pins(unsigned cs_pin, unsigned dc_pin) {
+    spi_cs_pin = cs_pin;
+    spi_dc_pin = dc_pin;
+    spi_selected = false;
+}
+
+void mock_panel_to_rows(uint8_t rows[SSD1306_HEIGHT][SSD1306_WIDTH / 8]) {
+    memset(rows, 0, SSD1306_HEIGHT * SSD1306_WIDTH / 8);
+    for (int y = 0; y < SSD1306_HEIGHT; y++) {
+        for (int x = 0; x < SSD1306_WIDTH; x++) {
+            bool on = mock_panel.gddram[(y / 8) * MOCK_PANEL_WIDTH + MOCK_GLASS_OFFSET + x] & (1 << (y & 7));
+            if (on) rows[y][x / 8] |= 0x80 >> (x & 7);
+        }
+    }
+}
+
+void mock_set_frame_hook(mock_frame_hook_t hook) {
+    frame_hook = hook;
+}
+
+void mock_set_bus_baudrate(uint32_t baudrate) {
+    bus_baudrate = baudrate;
+}
+
+// ---------------------------------------------------------------------------
+// Interrupts
+
+static irq_handler_t irq_handlers[32];
+static bool irq_enabled[32];
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { irq_handlers[num] = handler; }
+void irq_set_enabled(uint num, bool enabled) { irq_enabled[num] = enabled; }
+
+static void raise_irq(uint num) {
+    if (irq_enabled[num] && irq_handlers[num]) {
+        irq_handlers[num]();
+    }
+}
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) { (void)status; }
+
+// ---------------------------------------------------------------------------
+// I2C, SPI and DMA
+
+static i2c_hw_t i2c_regs[2];
+i2c_inst_t i2c0_inst = {&i2c_regs[0], 0};
+i2c_inst_t i2c1_inst = {&i2c_regs[1], 1};
+
+// Where the second panel answers; mock_panel takes every other address
+static int panel2_controller = -1;
+static uint8_t panel2_addr;
+
+void mock_i2c_panel2(unsigned controller, uint8_t addr) {
+    panel2_controller = controller;
+    panel2_addr = addr;
+}
+
+static mock_panel_t *i2c_panel(uint idx, uint8_t addr) {
+    return (int)idx == panel2_controller && addr == panel2_addr ? &mock_panel2 : &mock_panel;
+}
+
+// Each controller's wire is busy until this (virtual) time; controllers
+// run side by side
+static uint64_t i2c_free_at[2];
+
+// Put a transaction on controller `idx`'s wire after whatever is on it;
+// returns when it ends
+static uint64_t i2c_wire(uint idx, uint8_t addr, const uint8_t *bytes, size_t len) {
+    uint64_t start = i2c_free_at[idx] > now_us ? i2c_free_at[idx] : now_us;
+    i2c_free_at[idx] = start + panel_transaction(i2c_panel(idx, addr), bytes, len);
+    return i2c_free_at[idx];
+}
+
+// Injected faults per controller (mock_i2c_fault()): how many more
+// transactions fail and how, and whether a panel is holding SDA low
+static mock_i2c_fault_t i2c_fault_kind[2];
+static unsigned i2c_fault_count[2];
+static bool i2c_stuck[2];
+static uint8_t i2c_scl_pulses[2];
+
+void mock_i2c_fault(unsigned controller, mock_i2c_fault_t fault, unsigned count) {
+    i2c_fault_kind[controller] = fault;
+    i2c_fault_count[controller] = count;
+}
+
+// Power-on state: display off, default contrast, GDDRAM random
+static void panel_power_on(mock_panel_t *p) {
+    memset(p, 0, sizeof(*p));
+    memset(p->gddram, 0x5A, sizeof(p->gddram));
+    p->contrast = 0x7F;
+    p->col_end = MOCK_PANEL_WIDTH - 1;
+    p->page_end = MOCK_PANEL_PAGES - 1;
+}
+
+// Does a transaction to `addr` starting now on controller `idx` fail?
+// While the bus is stuck, every one does.
+static bool i2c_faulted(uint idx, uint8_t addr, mock_i2c_fault_t *fault) {
+    if (!i2c_stuck[idx]) {
+        if (!i2c_fault_count[idx]) return false;
+        i2c_fault_count[idx]--;
+        if (i2c_fault_kind[idx] == MOCK_I2C_NAK) {
+            *fault = MOCK_I2C_NAK;
+            return true;
+        }
+        // The glitch that wedges the bus also resets the panel
+        panel_power_on(i2c_panel(idx, addr));
+        i2c_stuck[idx] = true;
+        i2c_scl_pulses[idx] = 0;
+    }
+    *fault = MOCK_I2C_STUCK;
+    return true;
+}
+
+// SCL pulsed from GPIO: nine free a panel stuck mid-byte
+static void i2c_scl_pulse(uint idx) {
+    if (i2c_stuck[idx] && ++i2c_scl_pulses[idx] == 9) {
+        i2c_stuck[idx] = false;
+    }
+}
+
+static uint8_t i2c_tx[2][4096];
+static size_t i2c_tx_len[2];
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    // Also what recovery does: the block comes out of reset with empty FIFOs
+    i2c->hw->enable = 1;
+    i2c->hw->intr_mask = 0;
+    i2c_tx_len[i2c->index] = 0;
+    return baudrate;
+}
+
+// The divider takes the nearest whole number of clk_peri (= clk_sys) cycles
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate) {
+    (void)i2c;
+    uint32_t freq = sys_clock_khz * 1000;
+    uint32_t period = (freq + baudrate / 2) / baudrate;
+    return freq / period;
+}
+
+// A NAK is over after the address byte; on a stuck bus the controller
+// never gets a START out, so the call runs into its timeout
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us) {
+    (void)nostop;
+    mock_i2c_fault_t fault;
+    if (i2c_faulted(i2c->index, addr, &fault)) {
+        if (fault == MOCK_I2C_STUCK) {
+            mock_advance_us(timeout_us);
+            return PICO_ERROR_TIMEOUT;
+        }
+        mock_advance_us(bus_baudrate ? 9 * 1000000ull / bus_baudrate : 0);
+        return PICO_ERROR_GENERIC;
+    }
+    mock_advance_us(i2c_wire(i2c->index, addr, src, len) - now_us);
+    return (int)len;
+}
+
+static spi_hw_t spi_regs[2];
+spi_inst_t spi0_inst = {&spi_regs[0], 0};
+
+static uint spi_baudrate[2];
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    return spi_set_baudrate(spi, baudrate);
+}
+
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+    spi_baudrate[spi->index] = baudrate;
+    return baudrate;
+}
+
+uint spi_get_baudrate(const spi_inst_t *spi) {
+    return spi_baudrate[spi->index];
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    (void)spi;
+    for (size_t i = 0; i < len; i++) {
+        panel_spi_byte(src[i]);
+    }
+    return (int)len;
+}
+
+bool spi_is_busy(spi_inst_t *spi) { (void)spi; return false; }
+
+typedef struct {
+    dma_channel_config config;
+    volatile void *write_addr;
+    bool claimed;
+    bool stalled;  // Feeding a stuck I2C bus, busy until aborted
+} mock_dma_channel_t;
+
+static mock_dma_channel_t dma_channels[NUM_DMA_CHANNELS];
+static dma_channel_hw_t dma_channel_regs[NUM_DMA_CHANNELS];
+static uint32_t dma_irq1_raw;
+static uint32_t dma_irq1_enabled;
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    if (enabled) {
+        dma_irq1_enabled |= 1u << channel;
+    } else {
+        dma_irq1_enabled &= ~(1u << channel);
+    }
+}
+
+bool dma_channel_get_irq1_status(uint channel) { return (dma_irq1_raw & dma_irq1_enabled) & (1u << channel); }
+void dma_channel_acknowledge_irq1(uint channel) { dma_irq1_raw &= ~(1u << channel); }
+
+// A channel finished its transfer
+static void dma_complete(uint channel) {
+    dma_irq1_raw |= 1u << channel;
+    if (dma_irq1_raw & dma_irq1_enabled) {
+        raise_irq(DMA_IRQ_1);
+    }
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) { return &dma_channel_regs[channel]; }
+
+int dma_claim_unused_channel(bool required) {
+    for (int i = 0; i < NUM_DMA_CHANNELS; i++) {
+        if (!dma_channels[i].claimed) {
+            dma_channels[i].claimed = true;
+            return i;
+        }
+    }
+    return required ? 0 : -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = {DMA_SIZE_32, true, false, 0};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { c->size = size; }
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    dma_channels[channel].config = *config;
+    dma_channels[channel].write_addr = write_addr;
+    if (trigger) {
+        dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+    }
+}
+
+static void i2c_stop_det(uint idx, uint32_t status) {
+    i2c_hw_t *hw = &i2c_regs[idx];
+    hw->raw_intr_stat |= status | I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+    hw->intr_stat = hw->raw_intr_stat & hw->intr_mask;
+    if (hw->intr_stat) {
+        raise_irq(idx ? I2C1_IRQ : I2C0_IRQ);
+    }
+    hw->raw_intr_stat = 0;
+    hw->intr_stat = 0;
+}
+
+static int64_t i2c_stop_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    i2c_stop_det((uint)(uintptr_t)user_data, 0);
+    return 0;
+}
+
+// The transfer completes instantly. On I2C, DATA_CMD words queue up on
+// the controller until one carries STOP, then the whole transaction goes
+// to the panel model and the controller raises STOP_DET when it is off the
+// wire (at once unless bus time is modelled); a NAKed one raises TX_ABRT
+// at once and a stuck one nothing at all: its channel stalls on the full
+// TX FIFO, still reading from the start of the transfer, until aborted.
+// On SPI each word's low byte goes straight to the panel.
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count) {
+    mock_dma_channel_t *ch = &dma_channels[channel];
+    const volatile uint16_t *words = read_addr;
+    dma_channel_regs[channel].read_addr = (uintptr_t)(words + transfer_count);
+    for (uint idx = 0; idx < 2; idx++) {
+        if (ch->write_addr != &spi_regs[idx].dr) continue;
+        for (uint32_t i = 0; i < transfer_count; i++) {
+            panel_spi_byte(words[i] & 0xFF);
+        }
+        dma_complete(channel);
+        return;
+    }
+    for (uint idx = 0; idx < 2; idx++) {
+        i2c_hw_t *hw = &i2c_regs[idx];
+        if (ch->write_addr != &hw->data_cmd) continue;
+
+        bool stop = false;
+        for (uint32_t i = 0; i < transfer_count && i2c_tx_len[idx] < sizeof(i2c_tx[idx]); i++) {
+            i2c_tx[idx][i2c_tx_len[idx]++] = words[i] & 0xFF;
+            stop = words[i] & I2C_IC_DATA_CMD_STOP_BITS;
+        }
+        if (!stop) {
+            dma_complete(channel);
+            return;
+        }
+
+        mock_i2c_fault_t fault;
+        if (i2c_faulted(idx, hw->tar, &fault)) {
+            i2c_tx_len[idx] = 0;
+            if (fault == MOCK_I2C_NAK) {
+                dma_complete(channel);
+                i2c_stop_det(idx, I2C_IC_INTR_STAT_R_TX_ABRT_BITS);
+            } else {
+                ch->stalled = true;
+                dma_channel_regs[channel].read_addr = (uintptr_t)words;
+            }
+            return;
+        }
+        dma_complete(channel);
+        uint64_t end = i2c_wire(idx, hw->tar, i2c_tx[idx], i2c_tx_len[idx]);
+        i2c_tx_len[idx] = 0;
+        if (end > now_us) {
+            add_alarm_at(end, i2c_stop_alarm, (void *)(uintptr_t)idx, true);
+        } else {
+            i2c_stop_det(idx, 0);
+        }
+        return;
+    }
+}
+
+void dma_channel_abort(uint channel) { dma_channels[channel].stalled = false; }
+bool dma_channel_is_busy(uint channel) { return dma_channels[channel].stalled; }
+
+// ---------------------------------------------------------------------------
+// Flash
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    memset(mock_flash + flash_offs, 0xFF, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    // NOR programming only clears bits
+    for (size_t i = 0; i < count; i++) {
+        mock_flash[flash_offs + i] &= data[i];
+    }
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+void multicore_launch_core1(void (*entry)(void)) { (void)entry; }
+void multicore_lockout_victim_init(void) {}
+
+// ---------------------------------------------------------------------------
+// Time and alarms
+
+#define MAX_ALARMS 16
+
+typedef struct {
+    bool active;
+    uint64_t at;
+    alarm_callback_t callback;
+    void *user_data;
+} mock_alarm_t;
+
+static mock_alarm_t alarms[MAX_ALARMS + 1];  // ids start at 1
+
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    if (t <= now_us && fire_if_past) {
+        int64_t again = callback(0, user_data);
+        if (again == 0) return 0;
+        t = now_us + (again > 0 ? (uint64_t)again : (uint64_t)-again);
+    }
+    for (alarm_id_t id = 1; id <= MAX_ALARMS; id++) {
+        if (!alarms[id].active) {
+            alarms[id] = (mock_alarm_t){true, t, callback, user_data};
+            return id;
+        }
+    }
+    return -1;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return add_alarm_at(now_us + us, callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    return add_alarm_at(now_us + (uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t id) {
+    if (id <= 0 || id > MAX_ALARMS || !alarms[id].active) return false;
+    alarms[id].active = false;
+    return true;
+}
+
+static int64_t repeating_timer_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    repeating_timer_t *rt = user_data;
+    if (!rt->callback(rt)) return 0;
+    return rt->delay_us;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+    out->delay_us = delay_us < 0 ? -delay_us : delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->alarm_id = add_alarm_in_us(out->delay_us, repeating_timer_alarm, out, true);
+    return out->alarm_id > 0;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    bool ok = cancel_alarm(timer->alarm_id);
+    timer->alarm_id = 0;
+    return ok;
+}
+
+void mock_advance_us(uint64_t us) {
+    uint64_t target = now_us + us;
+
+    // Fire due alarms in time order
+    while (true) {
+        alarm_id_t next = 0;
+        for (alarm_id_t id = 1; id <= MAX_ALARMS; id++) {
+            if (alarms[id].active && alarms[id].at <= target &&
+                (next == 0 || alarms[id].at < alarms[next].at)) {
+                next = id;
+            }
+        }
+        if (next == 0) break;
+
+        mock_alarm_t alarm = alarms[next];
+        alarms[next].active = false;
+        if (alarm.at > now_us) now_us = alarm.at;
+
+        int64_t again = alarm.callback(next, alarm.user_data);
+        if (again != 0) {
+            // Positive: relative to the previous target, negative: to now
+            uint64_t at = again > 0 ? alarm.at + again : now_us - again;
+            alarms[next] = (mock_alarm_t){true, at, alarm.callback, alarm.user_data};
+        }
+    }
+    now_us = target;
+}
+
+void sleep_ms(uint32_t ms) { mock_advance_us((uint64_t)ms * 1000); }
+void sleep_us(uint64_t us) { mock_advance_us(us); }
+void sleep_until(absolute_time_t t) { mock_advance_us(t > now_us ? t - now_us : 0); }
+// Spinning lets virtual time run on to the next alarm (a transfer ending)
+// or, with none pending, by a microsecond
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+    (void)required;
+    sys_clock_khz = freq_khz;
+    return true;
+}
+
+void tight_loop_contents(void) {
+    alarm_id_t next = 0;
+    for (alarm_id_t id = 1; id <= MAX_ALARMS; id++) {
+        if (alarms[id].active && (next == 0 || alarms[id].at < alarms[next].at)) {
+            next = id;
+        }
+    }
+    if (next) {
+        mock_advance_us(alarms[next].at > now_us ? alarms[next].at - now_us : 0);
+    } else {
+        mock_advance_us(1);
+    }
+}
+uint get_core_num(void) { return 0; }
+
+absolute_time_t get_absolute_time(void) { return now_us; }
+uint64_t time_us_64(void) { return now_us; }
+uint32_t time_us_32(void) { return (uint32_t)now_us; }
+uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+absolute_time_t make_timeout_time_ms(uint32_t ms) { return now_us + (uint64_t)ms * 1000; }
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + (uint64_t)ms * 1000; }
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+bool time_reached(absolute_time_t t) { return now_us >= t; }
+
+bool best_effort_wfe_or_timeout(absolute_time_t t) {
+    if (t > now_us && t != at_the_end_of_time) {
+        mock_advance_us(t - now_us);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// GPIO and stdio
+
+static uint32_t gpio_irq_events[30];
+static gpio_irq_callback_t gpio_callback;
+static bool usb_connected;
+
+uint8_t mock_usb_out[MOCK_USB_OUT_MAX];
+size_t mock_usb_out_len;
+
+static void mock_usb_out_chars(const char *buf, int len) {
+    if (len > (int)(MOCK_USB_OUT_MAX - mock_usb_out_len)) {
+        len = MOCK_USB_OUT_MAX - mock_usb_out_len;
+    }
+    memcpy(mock_usb_out + mock_usb_out_len, buf, len);
+    mock_usb_out_len += len;
+}
+
+static void mock_usb_out_flush(void) {}
+
+stdio_driver_t stdio_usb = {
+    .out_chars = mock_usb_out_chars,
+    .out_flush = mock_usb_out_flush,
+};
+
+void stdio_init_all(void) {}
+void stdio_flush(void) { fflush(stdout); }
+int getchar_timeout_us(uint32_t timeout_us) { (void)timeout_us; return PICO_ERROR_TIMEOUT; }
+
+void gpio_init(uint gpio) { (void)gpio; }
+static bool gpio_out[30];
+
+void gpio_set_dir(uint gpio, bool out) {
+    // A pin driven low and let go again is a clock pulse if it is an I2C
+    // SCL pin (odd GPIOs; controller 0 or 1 alternates every two)
+    if (gpio_out[gpio] && !out && !gpio_levels[gpio] && (gpio & 1)) {
+        i2c_scl_pulse((gpio / 2) % 2);
+    }
+    gpio_out[gpio] = out;
+}
+void gpio_put(uint gpio, bool value) {
+    gpio_levels[gpio] = value;
+    if ((int)gpio == spi_cs_pin) {
+        panel_spi_select(!value);
+    }
+}
+bool gpio_get(uint gpio) { return gpio_levels[gpio]; }
+void gpio_pull_up(uint gpio) { gpio_levels[gpio] = true; }
+void gpio_set_function(uint gpio, int fn) { (void)gpio; (void)fn; }
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, events, enabled);
+    gpio_callback = callback;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+    if (enabled) {
+        gpio_irq_events[gpio] |= events;
+    } else {
+        gpio_irq_events[gpio] &= ~events;
+    }
+}
+
+void mock_gpio_set_input(unsigned pin, bool level) {
+    if (gpio_levels[pin] == level) return;
+    gpio_levels[pin] = level;
+
+    uint32_t event = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if ((gpio_irq_events[pin] & event) && gpio_callback) {
+        gpio_callback(pin, event);
+    }
+}
+
+bool stdio_usb_connected(void) { return usb_connected; }
+void mock_usb_connect(bool connected) { usb_connected = connected; }
+
+// ---------------------------------------------------------------------------
+// Clocks and dormant
+
+uint32_t mock_dormant_count;
+uint32_t mock_clock_inits;
+static uint32_t gpio_dormant_events[30];
+static int dormant_wake_pin = -1;
+
+bool clock_configure(clock_num_t clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq) {
+    (void)src;
+    (void)auxsrc;
+    (void)src_freq;
+    if (clk_index == clk_sys) sys_clock_khz = freq / 1000;
+    return true;
+}
+
+void clock_stop(clock_num_t clk_index) { (void)clk_index; }
+
+uint32_t clock_get_hz(clock_num_t clk_index) {
+    return clk_index == clk_sys ? sys_clock_khz * 1000 : 0;
+}
+
+void runtime_init_clocks(void) {
+    sys_clock_khz = 125000;
+    mock_clock_inits++;
+}
+
+void pll_deinit(PLL pll) { (void)pll; }
+
+void gpio_set_dormant_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+    if (enabled) {
+        gpio_dormant_events[gpio] |= events;
+    } else {
+        gpio_dormant_events[gpio] &= ~events;
+    }
+}
+
+void mock_dormant_wake_pin(int pin) { dormant_wake_pin = pin; }
+
+void xosc_dormant(void) {
+    mock_dormant_count++;
+    if (dormant_wake_pin >= 0 && (gpio_dormant_events[dormant_wake_pin] & GPIO_IRQ_EDGE_FALL)) {
+        mock_gpio_set_input(dormant_wake_pin, false);
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+void mock_reset(void) {
+    memset(&mock_panel, 0, sizeof(mock_panel));
+    mock_panel.col_end = MOCK_PANEL_WIDTH - 1;
+    mock_panel.page_end = MOCK_PANEL_PAGES - 1;
+    mock_panel2 = mock_panel;
+    panel2_controller = -1;
+    memset(i2c_free_at, 0, sizeof(i2c_free_at));
+    memset(&mock_bus_stats, 0, sizeof(mock_bus_stats));
+    memset(&mock_bus_stats2, 0, sizeof(mock_bus_stats2));
+    memset(mock_flash, 0xFF, sizeof(mock_flash));
+    memset(alarms, 0, sizeof(alarms));
+    memset(i2c_regs, 0, sizeof(i2c_regs));
+    memset(dma_channels, 0, sizeof(dma_channels));
+    memset(dma_channel_regs, 0, sizeof(dma_channel_regs));
+    memset(i2c_tx_len, 0, sizeof(i2c_tx_len));
+    memset(i2c_fault_count, 0, sizeof(i2c_fault_count));
+    memset(i2c_stuck, 0, sizeof(i2c_stuck));
+    memset(spi_baudrate, 0, sizeof(spi_baudrate));
+    memset(gpio_out, 0, sizeof(gpio_out));
+    memset(gpio_dormant_events, 0, sizeof(gpio_dormant_events));
+    dormant_wake_pin = -1;
+    mock_dormant_count = 0;
+    mock_clock_inits = 0;
+    usb_connected = false;
+    dma_irq1_raw = 0;
+    dma_irq1_enabled = 0;
+    spi_cs_pin = -1;
+    spi_dc_pin = -1;
+    spi_selected = false;
+    mock_usb_out_len = 0;
+    frame_hook = NULL;
+    bus_baudrate = 0;
+    sys_clock_khz = 125000;
+    now_us = 0;
+}
@@ -0,0 +1,103 @@
+#ifndef MOCK_HAL_H
+#define MOCK_HAL_H
+
+// Host-side stand-in for the parts of the Pico SDK the firmware uses.
+// Time is virtual (sleeps advance it, alarms fire as it passes), flash is
+// a RAM array mapped at XIP_BASE, and every I2C write (or SPI write with
+// the panel's CS low) is decoded by an SSD1306 model so tests can look at
+// what the panel would show.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The controller always has 128x64 of GDDRAM; the glass the firmware is
+// built for shows SSD1306_WIDTH columns of it (narrow glass sits in the
+// middle) and the first SSD1306_HEIGHT rows
+#define MOCK_PANEL_WIDTH 128
+#define MOCK_PANEL_PAGES 8
+#define MOCK_GLASS_OFFSET ((MOCK_PANEL_WIDTH - SSD1306_WIDTH) / 2)
+
+typedef struct {
+    uint8_t gddram[MOCK_PANEL_PAGES * MOCK_PANEL_WIDTH];
+    bool display_on;
+    uint8_t contrast;
+    bool scrolling;
+
+    // Addressing window and write pointer (horizontal addressing mode)
+    uint8_t col_start, col_end, col;
+    uint8_t page_start, page_end, page;
+
+    // Command bytes collected until the current command is complete
+    uint8_t cmd[8];
+    uint8_t cmd_len;
+} mock_panel_t;
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;          // On the wire, with each I2C transaction's address byte
+    uint32_t data_bytes;     // GDDRAM bytes written
+    uint32_t cmd_bytes;
+} mock_bus_stats_t;
+
+// The panel, and a second one that answers only where mock_i2c_panel2() puts
+// it, each with the traffic addressed to it
+extern mock_panel_t mock_panel;
+extern mock_panel_t mock_panel2;
+extern mock_bus_stats_t mock_bus_stats;
+extern mock_bus_stats_t mock_bus_stats2;
+
+// Everything written to stdio_usb.out_chars() since mock_reset()
+#define MOCK_USB_OUT_MAX (80 * 1024)
+extern uint8_t mock_usb_out[MOCK_USB_OUT_MAX];
+extern size_t mock_usb_out_len;
+
+// Called after every bus transaction that carried display data, with the
+// panel it went to
+typedef void (*mock_frame_hook_t)(const mock_panel_t *panel);
+
+void mock_reset(void);
+void mock_set_frame_hook(mock_frame_hook_t hook);
+// Let each transaction take its time on the wire at `baudrate`: 9 clocks
+// per byte on I2C, 8 on SPI (0, the default: transfers are instant). The
+// two I2C controllers' wires run side by side.
+void mock_set_bus_baudrate(uint32_t baudrate);
+// Wire the panel to SPI instead of I2C, with CS and D/C on these GPIOs
+void mock_spi_panel_pins(unsigned cs_pin, unsigned dc_pin);
+// Put mock_panel2 on I2C controller `controller` (0 or 1) at `addr`
+void mock_i2c_panel2(unsigned controller, uint8_t addr);
+// Make the next `count` transactions on I2C controller `controller` fail.
+// NAK: refused at the address byte. STUCK: the panel resets (back to
+// power-on state) and holds SDA low, so nothing on that controller
+// completes until SCL is pulsed nine times from GPIO.
+typedef enum {
+    MOCK_I2C_NAK,
+    MOCK_I2C_STUCK,
+} mock_i2c_fault_t;
+
+void mock_i2c_fault(unsigned controller, mock_i2c_fault_t fault, unsigned count);
+void mock_advance_us(uint64_t us);
+void mock_gpio_set_input(unsigned pin, bool level);
+void mock_usb_connect(bool connected);
+
+// xosc_dormant() returns at once, as if `pin` had been pulled low to wake
+// it; the edge is only seen if `pin` is enabled as a dormant wake source
+// (-1, the default: nothing wakes it, the pin stays as it is)
+void mock_dormant_wake_pin(int pin);
+// Times xosc_dormant() and runtime_init_clocks() ran since mock_reset()
+extern uint32_t mock_dormant_count;
+extern uint32_t mock_clock_inits;
+
+// Render what the glass shows into a 1bpp row-major bitmap
+void mock_panel_to_rows(uint8_t rows[SSD1306_HEIGHT][SSD1306_WIDTH / 8]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_HAL_H
@@ -0,0 +1,16 @@
+#ifndef MOCK_PICO_FLASH_H
+#define MOCK_PICO_FLASH_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_PICO_FLASH_H
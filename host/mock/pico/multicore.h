@@ -0,0 +1,18 @@
+#ifndef MOCK_PICO_MULTICORE_H
+#define MOCK_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host builds run everything on one thread; core 1 is never launched
+void multicore_launch_core1(void (*entry)(void));
+void multicore_lockout_victim_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_PICO_MULTICORE_H
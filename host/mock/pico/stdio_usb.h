@@ -0,0 +1,25 @@
+#ifndef MOCK_PICO_STDIO_USB_H
+#define MOCK_PICO_STDIO_USB_H
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Raw CDC output; the mock appends it to mock_usb_out
+typedef struct stdio_driver {
+    void (*out_chars)(const char *buf, int len);
+    void (*out_flush)(void);
+} stdio_driver_t;
+
+extern stdio_driver_t stdio_usb;
+
+// False unless mock_usb_connect() says a host is attached
+bool stdio_usb_connected(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_PICO_STDIO_USB_H
@@ -0,0 +1,97 @@
+#ifndef MOCK_PICO_STDLIB_H
+#define MOCK_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mock_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+extern uint8_t mock_flash[];
+#define XIP_BASE ((uintptr_t)mock_flash)
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+#define GPIO_IN 0
+#define GPIO_OUT 1
+#define GPIO_FUNC_SPI 1
+#define GPIO_FUNC_I2C 3
+#define GPIO_FUNC_SIO 5
+
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __wfi() ((void)0)
+#define __wfe() ((void)0)
+#define __sev() ((void)0)
+#define __dmb() ((void)0)
+
+#define at_the_end_of_time ((absolute_time_t)INT64_MAX)
+
+void stdio_init_all(void);
+void stdio_flush(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, int fn);
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t events);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_dormant_irq_enabled(uint gpio, uint32_t events, bool enabled);
+
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void sleep_until(absolute_time_t t);
+void tight_loop_contents(void);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+uint get_core_num(void);
+
+absolute_time_t get_absolute_time(void);
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+absolute_time_t from_us_since_boot(uint64_t us);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+bool time_reached(absolute_time_t t);
+bool best_effort_wfe_or_timeout(absolute_time_t t);
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+alarm_id_t add_alarm_at(absolute_time_t t, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t id);
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+    int64_t delay_us;
+    alarm_id_t alarm_id;
+    repeating_timer_callback_t callback;
+    void *user_data;
+};
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_PICO_STDLIB_H
@@ -0,0 +1,6 @@
+#ifndef MOCK_PICO_VERSION_H
+#define MOCK_PICO_VERSION_H
+
+#define PICO_SDK_VERSION_MAJOR 2
+
+#endif // MOCK_PICO_VERSION_H
@@ -0,0 +1,151 @@
+// Button debounce tests: bounce rejection, the re-sample at the end of the
+// window, the event ring filling up and running out of alarms, driven
+// through the mock GPIO edge IRQ.
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "config.h"
+#include "perf.c"
+#include "trace.c"
+#include "buttons.c"
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { printf("FAIL " __VA_ARGS__); printf("\n"); failures++; } \
+} while (0)
+
+// Fresh hardware, buttons released and nothing queued
+static void start(void) {
+    mock_reset();
+    button_head = 0;
+    button_tail = 0;
+    buttons_init();
+}
+
+// The take button, pulled up: low is pressed
+static void take(bool pressed) {
+    mock_gpio_set_input(BUTTON_PIN, !pressed);
+}
+
+static uint32_t drain(button_event_t *events, uint32_t max) {
+    uint32_t count = 0;
+    while (count < max && buttons_poll(&events[count])) count++;
+    return count;
+}
+
+static void test_bounce(void) {
+    int start_failures = failures;
+    start();
+
+    // Contacts chattering for a few ms after the press
+    take(true);
+    for (int i = 0; i < 4; i++) {
+        mock_advance_us(2000);
+        take(i % 2 == 1);
+    }
+    mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+    take(false);
+
+    button_event_t events[4];
+    uint32_t count = drain(events, 4);
+    CHECK(count == 2, "bounce: %u events, expected 2", count);
+    CHECK(count >= 1 && events[0].button == BUTTON_TAKE && events[0].pressed && events[0].time_us == 0,
+          "bounce: press not reported at the first edge");
+    CHECK(count == 2 && !events[1].pressed, "bounce: release not reported");
+    if (failures == start_failures) printf("ok   buttons bounce\n");
+}
+
+static void test_short_tap(void) {
+    int start_failures = failures;
+    start();
+
+    // Released inside the window: the press goes out at once, the
+    // release when the window ends and the pin is sampled again
+    take(true);
+    mock_advance_us(5000);
+    take(false);
+
+    button_event_t events[4];
+    CHECK(drain(events, 4) == 1 && events[0].pressed, "short tap: press not reported alone");
+    mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+    CHECK(drain(events, 4) == 1 && !events[0].pressed, "short tap: release not reported");
+    CHECK(events[0].time_us == BUTTON_DEBOUNCE_MS * 1000, "short tap: release at %u us", events[0].time_us);
+    if (failures == start_failures) printf("ok   buttons short tap\n");
+}
+
+static void test_overflow(void) {
+    int start_failures = failures;
+    start();
+
+    // More edges than the ring holds with the main loop not reading: the
+    // oldest are kept, the rest dropped
+    for (int i = 0; i < BUTTON_QUEUE_SIZE + 4; i++) {
+        take(i % 2 == 0);
+        mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+    }
+
+    button_event_t events[BUTTON_QUEUE_SIZE + 4];
+    uint32_t count = drain(events, BUTTON_QUEUE_SIZE + 4);
+    CHECK(count == BUTTON_QUEUE_SIZE, "overflow: %u events, expected %u", count, BUTTON_QUEUE_SIZE);
+    for (uint32_t i = 0; i < count; i++) {
+        if (events[i].pressed != (i % 2 == 0) || events[i].time_us != i * BUTTON_DEBOUNCE_MS * 1000) {
+            CHECK(false, "overflow: event %u out of order", i);
+            break;
+        }
+    }
+
+    // Drained, the ring takes events again
+    take(true);
+    CHECK(drain(events, 4) == 1 && events[0].pressed, "overflow: no event after draining");
+    if (failures == start_failures) printf("ok   buttons overflow\n");
+}
+
+static int64_t idle_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+    return 0;
+}
+
+static void test_no_alarm(void) {
+    int start_failures = failures;
+    start();
+
+    // Every alarm slot taken: the press can't start a debounce window, so
+    // the button must not stay locked out
+    alarm_id_t taken[16];
+    int count = 0;
+    alarm_id_t id;
+    while (count < 16 && (id = add_alarm_in_ms(1000, idle_alarm, NULL, false)) > 0) taken[count++] = id;
+    CHECK(add_alarm_in_ms(1000, idle_alarm, NULL, false) < 0, "no alarm: mock alarms not exhausted");
+
+    take(true);
+    mock_advance_us(5000);
+    take(false);
+
+    button_event_t events[4];
+    uint32_t events_count = drain(events, 4);
+    CHECK(events_count == 2 && events[0].pressed && !events[1].pressed,
+          "no alarm: %u events, expected a press and a release", events_count);
+
+    // With alarms back, the window works again
+    for (int i = 0; i < count; i++) cancel_alarm(taken[i]);
+    take(true);
+    mock_advance_us(2000);
+    take(false);
+    CHECK(drain(events, 4) == 1, "no alarm: bounce accepted with alarms free");
+    if (failures == start_failures) printf("ok   buttons no alarm\n");
+}
+
+int main(void) {
+    test_bounce();
+    test_short_tap();
+    test_overflow();
+    test_no_alarm();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
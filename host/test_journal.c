@@ -0,0 +1,175 @@
+// Turn-history journal tests: commit, reboot, wrap, a record torn by a
+// power cut and the USB export framing, against the mock flash.
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "config.h"
+#include "perf.c"
+#include "trace.c"
+#include "storage.c"
+#include "journal.c"
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { printf("FAIL " __VA_ARGS__); printf("\n"); failures++; } \
+} while (0)
+
+// What a power cycle leaves: flash only
+static void reboot(void) {
+    journal_scanned = false;
+    journal_queued = 0;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Decode an export and check its framing; returns the record count
+static uint32_t check_export(const char *name, uint32_t first_seq) {
+    mock_usb_out_len = 0;
+    journal_export();
+
+    const uint8_t *out = mock_usb_out;
+    uint32_t count = get_u32(out + 8);
+    size_t body = count * JOURNAL_RECORD_SIZE;
+    CHECK(memcmp(out, JOURNAL_EXPORT_MAGIC, 4) == 0, "%s: bad magic", name);
+    CHECK(out[4] == JOURNAL_EXPORT_VERSION && out[5] == JOURNAL_RECORD_SIZE, "%s: bad header", name);
+    CHECK(mock_usb_out_len == 12 + body + 4, "%s: %zu bytes for %u records", name, mock_usb_out_len, count);
+    CHECK(get_u32(out + 12 + body) == storage_crc32(out + 12, body), "%s: bad trailer", name);
+
+    // Oldest first, every slot valid and in sequence
+    for (uint32_t i = 0; i < count; i++) {
+        journal_record_t rec;
+        memcpy(&rec, out + 12 + i * JOURNAL_RECORD_SIZE, sizeof(rec));
+        if (rec.crc != journal_crc(&rec) || rec.seq != first_seq + i) {
+            CHECK(false, "%s: record %u has seq %u, expected %u", name, i, rec.seq, first_seq + i);
+            break;
+        }
+    }
+    return count;
+}
+
+static void test_commit(void) {
+    int start = failures;
+    mock_reset();
+    perf_reset();
+    reboot();
+
+    journal_append(JOURNAL_BOOT, 0, 1);
+    mock_advance_us(1500000);
+    journal_append(JOURNAL_TAKE, 0, 0);
+    journal_append(JOURNAL_DEFER, 1, 2);
+    CHECK(journal_slot_blank(0), "commit: written before flush");
+    journal_flush();
+
+    const journal_record_t *rec = journal_slot(1);
+    CHECK(journal_slot_valid(0) && journal_slot_valid(1) && journal_slot_valid(2), "commit: records not valid");
+    CHECK(rec->seq == 2 && rec->boot == 1 && rec->time_ms == 1500, "commit: seq %u boot %u time %u",
+          rec->seq, rec->boot, rec->time_ms);
+    CHECK(rec->event == JOURNAL_TAKE && rec->name == 0 && rec->turns == 0, "commit: wrong fields");
+    CHECK(journal_slot_blank(3), "commit: slot after the records written");
+    CHECK(perf_stats[PERF_SAVE_PROGRAM].count == 1, "commit: %u programs for one page",
+          perf_stats[PERF_SAVE_PROGRAM].count);
+    CHECK(perf_stats[PERF_SAVE_ERASE].count == 0, "commit: erased a blank sector");
+
+    // A new boot carries on after the newest record
+    reboot();
+    journal_append(JOURNAL_BOOT, 1, 2);
+    journal_flush();
+    rec = journal_slot(3);
+    CHECK(rec->seq == 4 && rec->boot == 2, "reboot: seq %u boot %u", rec->seq, rec->boot);
+    CHECK(check_export("commit", 1) == 4, "commit: export count");
+    if (failures == start) printf("ok   journal commit\n");
+}
+
+static void test_poll(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    // Held back while the state log is waiting out its idle window
+    persist_state(0, 2);
+    journal_append(JOURNAL_TAKE, 0, 2);
+    journal_poll();
+    CHECK(journal_slot_blank(0), "poll: committed during the idle window");
+    mock_advance_us(SAVE_IDLE_MS * 1000);
+    persist_poll();
+    journal_poll();
+    CHECK(journal_slot_valid(0), "poll: not committed after the idle window");
+
+    // A full page goes out without waiting
+    persist_state(0, 1);
+    for (uint32_t i = 0; i < JOURNAL_RECORDS_PER_PAGE; i++) {
+        journal_append(JOURNAL_DEFER, 0, 1);
+    }
+    journal_poll();
+    CHECK(journal_slot_valid(JOURNAL_RECORDS_PER_PAGE), "poll: full page not committed");
+    if (failures == start) printf("ok   journal poll\n");
+}
+
+static void test_wrap(void) {
+    int start = failures;
+    mock_reset();
+    perf_reset();
+    reboot();
+
+    // Fill the ring and run a sector and a half into the second lap
+    uint32_t total = JOURNAL_RECORDS_TOTAL + JOURNAL_RECORDS_PER_SECTOR * 3 / 2;
+    for (uint32_t i = 0; i < total; i++) {
+        journal_append(JOURNAL_TAKE, i % 3, i % 4);
+        if (journal_queued == JOURNAL_QUEUE_SIZE) journal_flush();
+    }
+    journal_flush();
+    CHECK(perf_stats[PERF_SAVE_ERASE].count == 2, "wrap: %u erases", perf_stats[PERF_SAVE_ERASE].count);
+
+    // Two sectors were reclaimed and refilled, the second one half way
+    uint32_t kept = JOURNAL_RECORDS_TOTAL - JOURNAL_RECORDS_PER_SECTOR / 2;
+    uint32_t first = total - kept + 1;
+    CHECK(check_export("wrap", first) == kept, "wrap: export count");
+
+    // The same view after a power cycle
+    reboot();
+    CHECK(check_export("wrap reboot", first) == kept, "wrap reboot: export count");
+    if (failures == start) printf("ok   journal wrap\n");
+}
+
+static void test_torn(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    for (int i = 0; i < 3; i++) journal_append(JOURNAL_TAKE, 0, i);
+    journal_flush();
+
+    // Power lost while the next record was being programmed: only its
+    // first bytes reached the slot
+    journal_record_t torn = {.seq = 4, .time_ms = 1234, .boot = 1, .event = JOURNAL_DEFER};
+    memcpy(mock_flash + JOURNAL_OFFSET + 3 * JOURNAL_RECORD_SIZE, &torn, 6);
+
+    // The next boot writes past it; the export leaves it out
+    reboot();
+    journal_append(JOURNAL_BOOT, 0, 1);
+    journal_append(JOURNAL_TAKE, 0, 0);
+    journal_flush();
+    CHECK(journal_slot_valid(4) && journal_slot(4)->seq == 4, "torn: next record not after the torn slot");
+    CHECK(check_export("torn", 1) == 5, "torn: export count");
+
+    // And the same after another power cycle
+    reboot();
+    CHECK(check_export("torn reboot", 1) == 5, "torn reboot: export count");
+    if (failures == start) printf("ok   journal torn\n");
+}
+
+int main(void) {
+    test_commit();
+    test_poll();
+    test_wrap();
+    test_torn();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
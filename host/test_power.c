@@ -0,0 +1,165 @@
+// Idle power policy tests: the stage deadlines power_poll() steps down
+// on, dormant entry and exit, and the press that wakes the device being
+// used up by the wake. Core 1 is stood in for by an alarm that applies
+// the panel power level the way its loop does.
+#include "firmware.h"
+#include "hardware/clocks.h"
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { printf("FAIL " __VA_ARGS__); printf("\n"); failures++; } \
+} while (0)
+
+#define CORE1_TICK_US 1000
+
+static uint64_t idle_start;
+
+static int64_t core1_tick(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+    render_apply_power();
+    return -CORE1_TICK_US;
+}
+
+// Fresh hardware with a screen up, buttons released and the idle timers
+// started
+static void start(void) {
+    firmware_reset();
+    draw_screen(0, 1);
+    button_head = 0;
+    button_tail = 0;
+    buttons_init();
+    render_power_target = RENDER_POWER_ON;
+    render_power_applied = RENDER_POWER_ON;
+    power_state = POWER_ACTIVE;
+    power_swallow = 0;
+    power_alarm = 0;
+    add_alarm_in_us(CORE1_TICK_US, core1_tick, NULL, false);
+    idle_start = time_us_64();
+    power_init();
+}
+
+// Idle on to `ms` after power_init(): a millisecond early nothing has
+// happened; on the deadline the stage's alarm has fired to wake the main
+// loop and power_poll() enters `state`
+static bool reach_stage(uint32_t ms, power_state_t state) {
+    mock_advance_us(idle_start + ms * 1000ull - 1000 - time_us_64());
+    power_poll();
+    bool early = power_state == state || power_alarm == 0;
+    mock_advance_us(1000);
+    bool alarm_fired = power_alarm == 0;
+    power_poll();
+    mock_advance_us(CORE1_TICK_US);
+    return !early && alarm_fired && power_state == state;
+}
+
+// Feed the queued button events through power_input() as the main loop
+// does; returns how many it passed on as input
+static int feed_buttons(void) {
+    int used = 0;
+    button_event_t event;
+    while (buttons_poll(&event)) {
+        if (!power_input(&event)) used++;
+    }
+    return used;
+}
+
+static void press(unsigned pin) {
+    mock_gpio_set_input(pin, false);
+    mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+}
+
+static void release(unsigned pin) {
+    mock_gpio_set_input(pin, true);
+    mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+}
+
+static void test_idle_stages(void) {
+    int start_failures = failures;
+    start();
+
+    CHECK(reach_stage(POWER_DIM_MS, POWER_DIMMED), "stages: not dimmed at %u ms", POWER_DIM_MS);
+    CHECK(mock_panel.display_on && mock_panel.contrast == POWER_DIM_CONTRAST, "stages: panel not dimmed");
+
+    CHECK(reach_stage(POWER_OFF_MS, POWER_DISPLAY_OFF), "stages: not off at %u ms", POWER_OFF_MS);
+    CHECK(!mock_panel.display_on, "stages: panel still on");
+    CHECK(clock_get_hz(clk_sys) == POWER_SLOW_CLOCK_KHZ * 1000, "stages: clk_sys at %u Hz",
+          clock_get_hz(clk_sys));
+
+    // A press wakes the panel at full speed and is used up by it, release too
+    press(DEFER_BUTTON_PIN);
+    release(DEFER_BUTTON_PIN);
+    CHECK(feed_buttons() == 0, "stages: wake press passed on as input");
+    mock_advance_us(CORE1_TICK_US);
+    CHECK(power_state == POWER_ACTIVE && mock_panel.display_on &&
+          mock_panel.contrast == SSD1306_DEFAULT_CONTRAST, "stages: panel not woken");
+    CHECK(clock_get_hz(clk_sys) == POWER_FULL_CLOCK_KHZ * 1000, "stages: clk_sys at %u Hz after wake",
+          clock_get_hz(clk_sys));
+
+    // The next press counts, and the idle timers start over from the wake
+    press(DEFER_BUTTON_PIN);
+    release(DEFER_BUTTON_PIN);
+    CHECK(feed_buttons() == 2, "stages: press after the wake not passed on");
+    idle_start = time_us_64();
+    power_init();
+    CHECK(reach_stage(POWER_DIM_MS, POWER_DIMMED), "stages: not dimmed again after the wake");
+    if (failures == start_failures) printf("ok   power stages\n");
+}
+
+static void test_dormant(void) {
+    int start_failures = failures;
+    start();
+    mock_dormant_wake_pin(BUTTON_PIN);
+
+    // Left waiting for the idle window when the device goes quiet
+    persist_state(1, 2);
+    journal_append(JOURNAL_TAKE, 1, 2);
+
+    // A USB host keeps it out of dormant
+    mock_usb_connect(true);
+    CHECK(reach_stage(POWER_DIM_MS, POWER_DIMMED) && reach_stage(POWER_OFF_MS, POWER_DISPLAY_OFF),
+          "dormant: idle stages not entered");
+    mock_advance_us(idle_start + POWER_DORMANT_MS * 1000ull - time_us_64());
+    power_poll();
+    CHECK(mock_dormant_count == 0 && power_state == POWER_DISPLAY_OFF, "dormant: entered with USB attached");
+
+    // Unplugged, it goes dormant a whole stage later and wakes on the press
+    mock_usb_connect(false);
+    idle_start = time_us_64();
+    mock_advance_us(POWER_DORMANT_MS * 1000ull - 1000);
+    power_poll();
+    CHECK(mock_dormant_count == 0, "dormant: entered early after USB went away");
+    mock_advance_us(1000);
+    power_poll();
+    CHECK(mock_dormant_count == 1, "dormant: %u entries", mock_dormant_count);
+    CHECK(storage_record_valid(storage_slot(0)) && journal_slot_valid(0), "dormant: pending saves not flushed");
+
+    // Out again on the boot clocks, then full speed with the panel on
+    CHECK(mock_clock_inits == 1, "dormant: clocks re-initialized %u times", mock_clock_inits);
+    CHECK(clock_get_hz(clk_sys) == POWER_FULL_CLOCK_KHZ * 1000, "dormant: clk_sys at %u Hz after wake",
+          clock_get_hz(clk_sys));
+    mock_advance_us(CORE1_TICK_US);
+    CHECK(power_state == POWER_ACTIVE && mock_panel.display_on, "dormant: panel not woken");
+    CHECK(perf_stats[PERF_WAKE].count == 1, "dormant: wake recorded %u times", perf_stats[PERF_WAKE].count);
+
+    // The press that woke it is swallowed, down and up, and not a turn
+    mock_advance_us(BUTTON_DEBOUNCE_MS * 1000);
+    release(BUTTON_PIN);
+    CHECK(feed_buttons() == 0, "dormant: wake press passed on as input");
+    press(BUTTON_PIN);
+    release(BUTTON_PIN);
+    CHECK(feed_buttons() == 2, "dormant: press after the wake not passed on");
+    if (failures == start_failures) printf("ok   power dormant\n");
+}
+
+int main(void) {
+    test_idle_stages();
+    test_dormant();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
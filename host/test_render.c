@@ -0,0 +1,791 @@
+// Golden-image tests: render every static screen and the slide between
+// names, then compare what the mock panel shows against host/golden/*.pbm
+// (host/golden/<W>x<H>/ when built for another panel size).
+// Run with --update to rewrite the golden files after an intended change.
+#include "firmware.h"
+#include <stdlib.h>
+
+// Snapshots cover the glass the firmware is built for, not all of GDDRAM
+#define FRAME_ROWS SSD1306_HEIGHT
+#define ROW_BYTES (SSD1306_WIDTH / 8)
+#define FRAME_BYTES (FRAME_ROWS * ROW_BYTES)
+#define MAX_FRAMES (SLIDE_FRAMES + 8)
+
+static const char *golden_dir;
+static bool update;
+static int failures;
+
+// Panel snapshots taken after every data transaction that changed what
+// it shows (a flush that only brings the panel to the frame it already
+// showed, such as the start of a scrolled slide after an invalidate, is
+// not a frame of its own)
+static uint8_t frames[MAX_FRAMES][FRAME_ROWS][ROW_BYTES];
+static uint8_t frame_before[FRAME_ROWS][ROW_BYTES];
+static int frame_count;
+
+static void capture_frame(const mock_panel_t *panel) {
+    if (panel == &mock_panel && frame_count < MAX_FRAMES) {
+        mock_panel_to_rows(frames[frame_count]);
+        const void *prev = frame_count ? frames[frame_count - 1] : frame_before;
+        if (memcmp(frames[frame_count], prev, sizeof(frames[0])) != 0) frame_count++;
+    }
+}
+
+static void start_capture(void) {
+    frame_count = 0;
+    mock_panel_to_rows(frame_before);
+    mock_set_frame_hook(capture_frame);
+}
+
+// Compare (or with --update, write) frames stacked vertically as one P4
+static void check_frames(const char *name, const uint8_t (*rows)[ROW_BYTES], int count) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, name);
+
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "P4\n%d %d\n", SSD1306_WIDTH, FRAME_ROWS * count);
+    size_t body_len = (size_t)count * FRAME_BYTES;
+
+    // PBM 1 is black; lit pixels are stored as 0
+    uint8_t *body = (uint8_t *)malloc(body_len);
+    for (size_t i = 0; i < body_len; i++) {
+        body[i] = ~((const uint8_t *)rows)[i];
+    }
+
+    if (update) {
+        FILE *f = fopen(path, "wb");
+        if (!f || fwrite(header, 1, header_len, f) != (size_t)header_len ||
+            fwrite(body, 1, body_len, f) != body_len || fclose(f) != 0) {
+            printf("FAIL %s: cannot write golden\n", name);
+            failures++;
+        } else {
+            printf("updated %s\n", path);
+        }
+        free(body);
+        return;
+    }
+
+    FILE *f = fopen(path, "rb");
+    uint8_t *golden = (uint8_t *)malloc(header_len + body_len + 1);
+    size_t got = f ? fread(golden, 1, header_len + body_len + 1, f) : 0;
+    if (f) fclose(f);
+
+    if (!f) {
+        printf("FAIL %s: missing %s\n", name, path);
+        failures++;
+    } else if (got != header_len + body_len || memcmp(golden, header, header_len) != 0) {
+        printf("FAIL %s: golden has a different size\n", name);
+        failures++;
+    } else {
+        size_t diff = 0;
+        for (size_t i = 0; i < body_len; i++) {
+            uint8_t x = golden[header_len + i] ^ body[i];
+            while (x) { diff += x & 1; x >>= 1; }
+        }
+        if (diff) {
+            printf("FAIL %s: %zu pixels differ\n", name, diff);
+            failures++;
+        } else {
+            printf("ok   %s\n", name);
+        }
+    }
+    free(golden);
+    free(body);
+}
+
+static void test_screens(void) {
+    for (uint8_t name = 0; name < num_names; name++) {
+        for (uint8_t turns = 1; turns <= 3; turns++) {
+            firmware_reset();
+            draw_screen(name, turns);
+            ssd1306_wait(&display);
+
+            char id[64];
+            snprintf(id, sizeof(id), "screen_%s_%u", names[name], turns);
+            uint8_t rows[FRAME_ROWS][ROW_BYTES];
+            mock_panel_to_rows(rows);
+            check_frames(id, (const uint8_t (*)[ROW_BYTES])rows, 1);
+        }
+    }
+}
+
+// Slides play from the compressed assets when the panel shows the old
+// screen; with the panel state unknown they are composited at runtime.
+// Both must produce the same frames.
+static void test_transitions(void) {
+    static const char *const paths[] = {"asset", "runtime"};
+
+    for (int path = 0; path < 2; path++) {
+        for (uint8_t old = 0; old < num_names; old++) {
+            uint8_t next = (old + 1) % num_names;
+
+            firmware_reset();
+            draw_screen(old, 1);
+            if (path == 1) {
+                ssd1306_invalidate(&display);
+            }
+
+            start_capture();
+            animate_transition(old, next, 1);
+            ssd1306_wait(&display);
+            mock_set_frame_hook(NULL);
+
+            char id[64];
+            snprintf(id, sizeof(id), "transition_%s_%s", names[old], names[next]);
+            printf("[%s] ", paths[path]);
+            bool asset = DISPLAY_ANIM_ASSETS && !DISPLAY_HW_SCROLL && path == 0;
+            if ((perf_stats[PERF_RENDER].count == 0) != asset) {
+                printf("FAIL %s: slide did not take the %s path\n", id, paths[path]);
+                failures++;
+                continue;
+            }
+            check_frames(id, (const uint8_t (*)[ROW_BYTES])frames, frame_count);
+        }
+    }
+}
+
+// Is the panel showing `name` at `turns`?
+static bool panel_shows(uint8_t name, uint8_t turns) {
+    uint8_t shown[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(shown);
+
+    firmware_reset();
+    draw_screen(name, turns);
+    ssd1306_wait(&display);
+    uint8_t expected[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(expected);
+    return memcmp(shown, expected, sizeof(shown)) == 0;
+}
+
+// A bus slow enough that a slide frame outlasts a tick: a scroll frame
+// is only a column, but its ticks are also closer together
+#if DISPLAY_HW_SCROLL
+#define SLIDE_SLOW_BAUDRATE 10000
+#else
+#define SLIDE_SLOW_BAUDRATE 100000
+#endif
+
+// On a slow bus the slide drops frames to keep its length. Every frame
+// that does go out, including those that fold several asset deltas into
+// one flush, must be one of the slide's steps, in order.
+static void test_slide_timing(void) {
+    static uint8_t steps[SLIDE_FRAMES + 1][FRAME_ROWS][ROW_BYTES];
+    static const char *const paths[] = {"asset", "runtime"};
+
+    firmware_reset();
+    ssd1306_sprite_t old_content, new_content;
+    render_content_sprite(&old_content, slide_pixels[0], names[0], 1);
+    render_content_sprite(&new_content, slide_pixels[1], names[1], 1);
+    for (int16_t i = 0; i <= SLIDE_FRAMES; i++) {
+        draw_slide_frame(&old_content, &new_content, i * (DISPLAY_WIDTH / SLIDE_FRAMES));
+        ssd1306_display(&display);
+        mock_panel_to_rows(steps[i]);
+    }
+
+    for (int path = 0; path < 2; path++) {
+        firmware_reset();
+        draw_screen(0, 1);
+        if (path == 1) {
+            ssd1306_invalidate(&display);
+        }
+        perf_reset();
+        firmware_bus_baudrate(SLIDE_SLOW_BAUDRATE);
+
+        start_capture();
+        animate_transition(0, 1, 1);
+        ssd1306_wait(&display);
+        mock_set_frame_hook(NULL);
+        mock_set_bus_baudrate(0);
+
+        uint32_t dropped = perf_anim_dropped;
+        int step = 0;
+        bool in_order = true;
+        for (int f = 0; f < frame_count - 1 && in_order; f++) {
+            while (step <= SLIDE_FRAMES && memcmp(frames[f], steps[step], sizeof(steps[step])) != 0) step++;
+            in_order = step <= SLIDE_FRAMES;
+        }
+
+        if (dropped == 0) {
+            printf("FAIL [%s] slide_timing: no frames dropped at %u kHz\n", paths[path], SLIDE_SLOW_BAUDRATE / 1000);
+            failures++;
+        } else if (!in_order) {
+            printf("FAIL [%s] slide_timing: frame is not a slide step in order\n", paths[path]);
+            failures++;
+        } else if (!panel_shows(1, 1)) {
+            printf("FAIL [%s] slide_timing: slide did not end on the new screen\n", paths[path]);
+            failures++;
+        } else {
+            printf("ok   [%s] slide_timing (%u frames dropped)\n", paths[path], dropped);
+        }
+    }
+}
+
+// Command posted from the frame hook once the slide is under way
+static uint32_t interrupt_cmd;
+static int interrupt_frames;
+
+static void interrupt_slide(const mock_panel_t *panel) {
+    if (panel != &mock_panel) return;
+    interrupt_frames++;
+    if (interrupt_cmd) {
+        render_try_push(interrupt_cmd);
+        interrupt_cmd = 0;
+    }
+}
+
+// A defer on the incoming name retargets the running slide; anything else
+// cancels it and is drawn next
+static void test_slide_interrupt(void) {
+    firmware_reset();
+    draw_screen(0, 1);
+    interrupt_cmd = RENDER_CMD(RENDER_SHOW, 1, 1, 2);
+    mock_set_frame_hook(interrupt_slide);
+    animate_transition(0, 1, 1);
+    ssd1306_wait(&display);
+    mock_set_frame_hook(NULL);
+
+    uint32_t cmd;
+    if (render_next(&cmd)) {
+        printf("FAIL slide_retarget: command left over\n");
+        failures++;
+    } else if (!panel_shows(1, 2)) {
+        printf("FAIL slide_retarget: slide did not end on the retargeted screen\n");
+        failures++;
+    } else {
+        printf("ok   slide_retarget\n");
+    }
+
+    firmware_reset();
+    draw_screen(0, 1);
+    interrupt_cmd = RENDER_CMD(RENDER_SHOW, 0, 0, 2);
+    interrupt_frames = 0;
+    mock_set_frame_hook(interrupt_slide);
+    animate_transition(0, 1, 1);
+    mock_set_frame_hook(NULL);
+
+    if (!render_next(&cmd) || cmd != RENDER_CMD(RENDER_SHOW, 0, 0, 2)) {
+        printf("FAIL slide_cancel: interrupting command not handed back\n");
+        failures++;
+    } else if (interrupt_frames > 1) {
+        printf("FAIL slide_cancel: slide went on for %d frames\n", interrupt_frames);
+        failures++;
+    } else {
+        printf("ok   slide_cancel\n");
+    }
+}
+
+// A partial flush must leave the panel identical to a full redraw
+static void test_partial_flush(void) {
+    firmware_reset();
+    draw_screen(0, 1);
+    draw_screen(0, 3);
+    draw_screen(0, 2);
+    ssd1306_wait(&display);
+
+    uint8_t partial[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(partial);
+
+    firmware_reset();
+    draw_screen(0, 2);
+    ssd1306_wait(&display);
+
+    uint8_t full[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(full);
+
+    if (memcmp(partial, full, sizeof(full)) != 0) {
+        printf("FAIL partial_flush: panel differs from a full redraw\n");
+        failures++;
+    } else {
+        printf("ok   partial_flush\n");
+    }
+}
+
+// Every pre-rendered frame must match what the runtime renderer draws
+static void test_state_frames(void) {
+    for (uint8_t name = 0; name < STATE_FRAME_NAMES; name++) {
+        for (uint8_t turns = 1; turns <= STATE_FRAME_TURNS; turns++) {
+            firmware_reset();
+            render_screen(name, turns);
+
+            const uint16_t *frame = state_frames[name][turns - 1];
+            size_t diff = 0;
+            for (size_t i = 0; i < SSD1306_BUFFER_SIZE; i++) {
+                diff += display.buffer[i] != (uint8_t)frame[SSD1306_FLUSH_HEADER + i];
+            }
+
+            char id[64];
+            snprintf(id, sizeof(id), "state_frame_%s_%u", names[name], turns);
+            if (diff) {
+                printf("FAIL %s: %zu bytes differ from render_screen()\n", id, diff);
+                failures++;
+            } else {
+                printf("ok   %s\n", id);
+            }
+        }
+    }
+}
+
+// The same screens and slides with the panel on SPI: the backend sends the
+// I2C-staged frames (including those from flash) without the I2C framing
+static void test_spi_bus(void) {
+    for (uint8_t name = 0; name < num_names; name++) {
+        for (uint8_t turns = 1; turns <= 3; turns++) {
+            firmware_reset_spi();
+            draw_screen(name, turns);
+            ssd1306_wait(&display);
+
+            char id[64];
+            snprintf(id, sizeof(id), "screen_%s_%u", names[name], turns);
+            uint8_t rows[FRAME_ROWS][ROW_BYTES];
+            mock_panel_to_rows(rows);
+            printf("[spi] ");
+            check_frames(id, (const uint8_t (*)[ROW_BYTES])rows, 1);
+        }
+    }
+
+    firmware_reset_spi();
+    draw_screen(0, 1);
+    start_capture();
+    animate_transition(0, 1, 1);
+    ssd1306_wait(&display);
+    mock_set_frame_hook(NULL);
+    printf("[spi] ");
+    check_frames("transition_Maia_Adalie", (const uint8_t (*)[ROW_BYTES])frames, frame_count);
+
+    // No address or control bytes: a full frame is the window commands
+    // and the data
+    firmware_reset_spi();
+    draw_screen(1, 1);
+    ssd1306_wait(&display);
+    if (perf_bus_bytes != mock_bus_stats.bytes || perf_bus_transactions != mock_bus_stats.transactions) {
+        printf("FAIL spi_counters: %u bytes / %u transactions counted, panel saw %u / %u\n",
+               perf_bus_bytes, perf_bus_transactions, mock_bus_stats.bytes, mock_bus_stats.transactions);
+        failures++;
+    } else if (mock_bus_stats.bytes != mock_bus_stats.cmd_bytes + mock_bus_stats.data_bytes) {
+        printf("FAIL spi_counters: %u bytes on the wire for %u command and %u data\n",
+               mock_bus_stats.bytes, mock_bus_stats.cmd_bytes, mock_bus_stats.data_bytes);
+        failures++;
+    } else {
+        printf("ok   spi_counters\n");
+    }
+}
+
+// A second panel on either controller ends every slide showing the same screen
+static void test_mirror(void) {
+    static const struct {
+        const char *id;
+        i2c_inst_t *port;
+        uint8_t addr;
+    } setups[] = {
+        {"i2c1 0x3C", i2c1, 0x3C},
+        {"i2c0 0x3D", i2c0, 0x3D},
+    };
+
+    for (size_t s = 0; s < count_of(setups); s++) {
+        int start = failures;
+        for (int path = 0; path < 2; path++) {
+            firmware_reset_mirror(setups[s].port, setups[s].addr);
+            mock_set_bus_baudrate(I2C_BAUDRATE);
+            draw_screen(0, 1);
+            if (path == 1) {
+                // Off the pre-built slide onto the runtime one
+                ssd1306_invalidate(&display);
+            }
+            animate_transition(0, 1, 1);
+            ssd1306_set_contrast(&display, 0x40);
+            ssd1306_wait(&display);
+            mock_set_bus_baudrate(0);
+
+            if (memcmp(mock_panel.gddram, mock_panel2.gddram, sizeof(mock_panel.gddram)) != 0) {
+                printf("FAIL mirror %s: panels differ after the slide\n", setups[s].id);
+                failures++;
+            } else if (mock_panel2.contrast != 0x40 || !mock_panel2.display_on) {
+                printf("FAIL mirror %s: commands did not reach the second panel\n", setups[s].id);
+                failures++;
+            } else if (!panel_shows(1, 1)) {
+                printf("FAIL mirror %s: slide did not end on the new screen\n", setups[s].id);
+                failures++;
+            }
+        }
+        if (failures == start) printf("ok   mirror %s\n", setups[s].id);
+    }
+}
+
+// With clk_sys slowed the bus runs at whatever the re-set divider gives,
+// and the driver's deadlines follow it: flushes there don't time out
+static bool test_power_clock(void) {
+    firmware_reset();
+    draw_screen(0, 1);
+    set_sys_clock_khz(POWER_SLOW_CLOCK_KHZ, true);
+    renderer_clock_changed();
+    uint32_t slow = display_bus.bus.baudrate;
+    uint32_t achieved = i2c_set_baudrate(I2C_PORT, I2C_BAUDRATE);
+    mock_set_bus_baudrate(slow);
+    draw_screen(1, 3);
+    mock_set_bus_baudrate(0);
+    set_sys_clock_khz(POWER_FULL_CLOCK_KHZ, true);
+    renderer_clock_changed();
+
+    if (slow != achieved || perf_faults[PERF_FAULT_TIMEOUT] != 0) {
+        printf("FAIL power: bus at %u Hz after a clock change, %u timeouts\n",
+               slow, perf_faults[PERF_FAULT_TIMEOUT]);
+        return false;
+    }
+    return true;
+}
+
+// Dim, sleep and wake: the panel keeps its frame and waking costs a single
+// transaction, timed from the wake edge
+static void test_power(void) {
+    firmware_reset();
+    render_screen(1, 2);
+    ssd1306_display(&display);
+    ssd1306_wait(&display);
+    uint8_t before[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(before);
+
+    renderer_set_power(RENDER_POWER_DIM, 0);
+    render_apply_power();
+    bool dimmed = mock_panel.display_on && mock_panel.contrast == POWER_DIM_CONTRAST;
+    renderer_set_power(RENDER_POWER_OFF, 0);
+    render_apply_power();
+    bool slept = !mock_panel.display_on && renderer_power_settled();
+
+    uint32_t edge = time_us_32();
+    mock_advance_us(500);
+    uint32_t transactions = mock_bus_stats.transactions;
+    renderer_set_power(RENDER_POWER_ON, edge);
+    render_apply_power();
+
+    uint8_t after[FRAME_ROWS][ROW_BYTES];
+    mock_panel_to_rows(after);
+    if (!dimmed || !slept) {
+        printf("FAIL power: dim %d, off %d\n", dimmed, slept);
+        failures++;
+    } else if (!mock_panel.display_on || mock_panel.contrast != SSD1306_DEFAULT_CONTRAST) {
+        printf("FAIL power: panel not back on at full contrast\n");
+        failures++;
+    } else if (mock_bus_stats.transactions - transactions != 1 || memcmp(before, after, sizeof(before)) != 0) {
+        printf("FAIL power: wake took %u transactions or lost the frame\n",
+               mock_bus_stats.transactions - transactions);
+        failures++;
+    } else if (perf_stats[PERF_WAKE].count != 1 || perf_stats[PERF_WAKE].max < 500) {
+        printf("FAIL power: wake recorded %u times, max %u us\n",
+               perf_stats[PERF_WAKE].count, perf_stats[PERF_WAKE].max);
+        failures++;
+    } else if (!test_power_clock()) {
+        failures++;
+    } else {
+        printf("ok   power\n");
+    }
+}
+
+#if ENABLE_TRACE
+// A state change shows up in the dump as the handoff, then the flushes that
+// put it on the panels, in time order
+static void test_trace(void) {
+    firmware_reset();
+    memset(trace_rings, 0, sizeof(trace_rings));
+    renderer_show(1, 2);
+    uint32_t cmd;
+    render_next(&cmd);
+    draw_screen(1, 2);
+    ssd1306_wait(&display);
+
+    mock_usb_out_len = 0;
+    trace_dump();
+    const uint8_t *out = mock_usb_out;
+    uint32_t count;
+    memcpy(&count, out + 12, sizeof(count));
+    const trace_record_t *recs = (const trace_record_t *)(out + 16);
+
+    // The handoff, then a flush begun and ended for each panel
+    bool order = count == 1 + 2 * (1 + DISPLAY_MIRROR) && recs[0].event == TRACE_STATE;
+    uint32_t open = 0;
+    for (uint32_t i = 1; order && i < count; i++) {
+        if (recs[i].event == TRACE_FLUSH_BEGIN) {
+            open++;
+        } else {
+            order = recs[i].event == TRACE_FLUSH_END && open-- > 0;
+        }
+        order = order && recs[i].time_us >= recs[i - 1].time_us;
+    }
+    if (memcmp(out, TRACE_DUMP_MAGIC, 4) != 0 || out[5] != sizeof(trace_record_t) ||
+        mock_usb_out_len != 12 + TRACE_CORES * 4 + count * sizeof(trace_record_t)) {
+        printf("FAIL trace: bad dump framing (%zu bytes)\n", mock_usb_out_len);
+        failures++;
+    } else if (!order || recs[0].arg != (1 | 2 << 8)) {
+        printf("FAIL trace: %u events, not state/flush begin/flush end\n", count);
+        failures++;
+    } else {
+        printf("ok   trace\n");
+    }
+}
+#endif
+
+// The firmware's own bus counters must agree with what the panels received
+static void test_perf_counters(void) {
+    firmware_reset();
+    render_screen(0, 1);
+    ssd1306_display(&display);
+    animate_transition(0, 1, 1);
+    ssd1306_wait(&display);
+
+    // Both panels' traffic when mirrored (mock_bus_stats2 is zero otherwise)
+    uint32_t bytes = mock_bus_stats.bytes + mock_bus_stats2.bytes;
+    uint32_t transactions = mock_bus_stats.transactions + mock_bus_stats2.transactions;
+    if (perf_bus_bytes != bytes || perf_bus_transactions != transactions) {
+        printf("FAIL perf_counters: %u bytes / %u transactions counted, panels saw %u / %u\n",
+               perf_bus_bytes, perf_bus_transactions, bytes, transactions);
+        failures++;
+    } else if (perf_stats[PERF_FLUSH].count == 0 || perf_stats[PERF_RENDER].count == 0) {
+        printf("FAIL perf_counters: render/flush not recorded\n");
+        failures++;
+    } else {
+        printf("ok   perf_counters\n");
+    }
+}
+
+// Boot: the saved screen core 0 queues before starting core 1 goes out
+// right after the init sequence, while the panel is still dark, and
+// nothing reaches the bus before the panel has powered up
+static bool boot_frame_dark;
+
+static void boot_frame_hook(const mock_panel_t *panel) {
+    if (panel == &mock_panel) boot_frame_dark = !mock_panel.display_on;
+}
+
+static void test_boot(void) {
+    mock_reset();
+    perf_reset();
+    firmware_buses();
+    perf_boot_us = 0;
+    gpio_put(LED_PIN, 1);
+    renderer_show(1, 2);
+
+    boot_frame_dark = false;
+    mock_set_frame_hook(boot_frame_hook);
+    mock_set_bus_baudrate(I2C_BAUDRATE);
+    render_boot();
+    mock_set_bus_baudrate(0);
+    mock_set_frame_hook(NULL);
+
+    if (!boot_frame_dark || !mock_panel.display_on) {
+        printf("FAIL boot: frame not sent before the panel was lit\n");
+        failures++;
+    } else if (mock_bus_stats.transactions != 3) {
+        printf("FAIL boot: %u transactions for init, frame and wake\n", mock_bus_stats.transactions);
+        failures++;
+    } else if (perf_boot_us < DISPLAY_POWER_UP_MS * 1000 || perf_boot_us != time_us_32()) {
+        printf("FAIL boot: first frame reported at %u us\n", perf_boot_us);
+        failures++;
+    } else if (gpio_get(LED_PIN)) {
+        printf("FAIL boot: LED still on\n");
+        failures++;
+    } else if (!panel_shows(1, 2)) {
+        printf("FAIL boot: panel does not show the saved screen\n");
+        failures++;
+    } else {
+        printf("ok   boot (first frame %u us after reset)\n", perf_boot_us);
+    }
+}
+
+// Bus faults: a NAKed command is retried, a panel that keeps refusing is
+// re-initialized before the next frame, and a stuck bus is clocked free
+// within the flush's deadline, the panel (reset by the glitch) set up
+// again and sent the whole frame from the kept buffer
+static void test_bus_faults(void) {
+    int start = failures;
+
+    firmware_reset();
+    draw_screen(0, 1);
+    perf_reset();
+    mock_i2c_fault(0, MOCK_I2C_NAK, 1);
+    ssd1306_set_contrast(&display, 0x40);
+    draw_screen(1, 1);
+    if (mock_panel.contrast != 0x40 || perf_faults[PERF_FAULT_NAK] != 1 ||
+        perf_faults[PERF_FAULT_RETRY] != 1 || perf_faults[PERF_FAULT_REINIT] != 0) {
+        printf("FAIL bus_faults: NAK not retried (contrast 0x%02X)\n", mock_panel.contrast);
+        failures++;
+    }
+
+    mock_i2c_fault(0, MOCK_I2C_NAK, SSD1306_BUS_RETRIES + 1);
+    ssd1306_set_contrast(&display, 0x20);
+    mock_panel.contrast = 0x7F;  // As if the panel had reset as well
+    memset(mock_panel.gddram, 0x5A, sizeof(mock_panel.gddram));
+    draw_screen(1, 2);
+    if (perf_faults[PERF_FAULT_REINIT] != 1 || mock_panel.contrast != 0x20 || !panel_shows(1, 2)) {
+        printf("FAIL bus_faults: panel not re-initialized after the retries ran out\n");
+        failures++;
+    }
+
+    // Stuck while a command goes out: recovered, retried, then re-init
+    firmware_reset();
+    draw_screen(0, 1);
+    perf_reset();
+    mock_i2c_fault(0, MOCK_I2C_STUCK, 1);
+    ssd1306_set_contrast(&display, 0x30);
+    draw_screen(0, 2);
+    if (perf_faults[PERF_FAULT_TIMEOUT] != 1 || perf_faults[PERF_FAULT_RECOVERY] != 1 ||
+        perf_faults[PERF_FAULT_REINIT] != 1 || mock_panel.contrast != 0x30 || !mock_panel.display_on ||
+        !panel_shows(0, 2)) {
+        printf("FAIL bus_faults: stuck command not recovered\n");
+        failures++;
+    }
+
+    // Stuck in the middle of a flush, with bus time modelled
+    firmware_reset();
+    draw_screen(0, 1);
+    perf_reset();
+    mock_set_bus_baudrate(I2C_BAUDRATE);
+    mock_i2c_fault(0, MOCK_I2C_STUCK, 1);
+    uint64_t t0 = time_us_64();
+    draw_screen(1, 1);
+    uint32_t took = (uint32_t)(time_us_64() - t0);
+    mock_set_bus_baudrate(0);
+    uint32_t bound = 2 * ssd1306_bus_timeout_us(&display_bus.bus, 1 + SSD1306_FLUSH_HEADER + SSD1306_BUFFER_SIZE);
+    if (perf_faults[PERF_FAULT_TIMEOUT] != 1 || perf_faults[PERF_FAULT_RECOVERY] != 1 ||
+        perf_faults[PERF_FAULT_REINIT] != 1 || !mock_panel.display_on || !panel_shows(1, 1)) {
+        printf("FAIL bus_faults: stuck flush not recovered\n");
+        failures++;
+    } else if (took > bound) {
+        printf("FAIL bus_faults: stuck flush took %u us (bound %u)\n", took, bound);
+        failures++;
+    }
+
+    // Stuck while DMA sends a frame straight from flash: a save can't wait
+    // for it with core 1 parked, so it is put off until the flush has been
+    // ended at its deadline
+    firmware_reset();
+    storage_scanned = false;
+    uint16_t *xip_frame = (uint16_t *)(mock_flash + FLASH_TARGET_OFFSET - FLASH_SECTOR_SIZE);
+    memcpy(xip_frame, state_frames[1][0], sizeof(state_frames[1][0]));
+    mock_i2c_fault(0, MOCK_I2C_STUCK, 1);
+    ssd1306_display_frame(&display, xip_frame);
+    t0 = time_us_64();
+    bool saved = save_state(1, 1);
+    uint32_t waited = (uint32_t)(time_us_64() - t0);
+    ssd1306_wait(&display);
+    uint8_t current, turns;
+    if (saved || waited > STORAGE_XIP_DMA_TIMEOUT_US + 1000) {
+        printf("FAIL bus_faults: save waited %u us on a stuck frame from flash\n", waited);
+        failures++;
+    } else if (!save_state(1, 1) || !load_state(&current, &turns) || current != 1 || turns != 1) {
+        printf("FAIL bus_faults: save not retried after the stuck flush\n");
+        failures++;
+    } else {
+        draw_screen(1, 1);
+        if (perf_faults[PERF_FAULT_REINIT] != 1 || !panel_shows(1, 1)) {
+            printf("FAIL bus_faults: panel not recovered after a stuck frame from flash\n");
+            failures++;
+        }
+    }
+
+    if (failures == start) printf("ok   bus_faults (stuck flush over in %u us)\n", took);
+}
+
+// Clipping: with a clip rectangle every primitive leaves exactly the
+// pixels it draws without one inside it, and nothing outside
+static bool buffer_pixel(const uint8_t *buf, int16_t x, int16_t y) {
+    return buf[x + (y / 8) * DISPLAY_WIDTH] & (1 << (y & 7));
+}
+
+static void draw_random_primitive(int kind, const int16_t *v, const ssd1306_sprite_t *sprite) {
+    switch (kind) {
+        case 0: ssd1306_draw_pixel(&display, v[0], v[1], true); break;
+        case 1: ssd1306_draw_line(&display, v[0], v[1], v[2], v[3], true); break;
+        case 2: ssd1306_draw_rect(&display, v[0], v[1], v[2] - v[0], v[3] - v[1], true); break;
+        case 3: ssd1306_fill_rect(&display, v[0], v[1], v[2] - v[0], v[3] - v[1], true); break;
+        case 4: ssd1306_draw_string(&display, v[0], v[1], "Turn 42!", true); break;
+        case 5: ssd1306_draw_string_scaled(&display, v[0], v[1], "Adalie", 1 + (v[2] & 3), true); break;
+        case 6: ssd1306_blit(&display, sprite, v[0], v[1], SSD1306_BLIT_SET); break;
+    }
+}
+
+static void test_clip(void) {
+    static const int16_t clips[][4] = {
+        {0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT}, {10, 5, 50, 30}, {-5, 19, 40, 100}, {100, 60, 40, 10}, {30, 30, 0, 5},
+    };
+    static uint8_t whole[SSD1306_BUFFER_SIZE];
+    static uint8_t pixels[SSD1306_BUFFER_SIZE];
+    ssd1306_sprite_t sprite;
+
+    firmware_reset();
+    draw_content(names[1], 3, 0, true);
+    ssd1306_sprite_capture(&display, &sprite, pixels, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT / 8);
+
+    int start = failures;
+    srand(1);
+    for (size_t c = 0; c < count_of(clips); c++) {
+        const int16_t *clip = clips[c];
+        for (int i = 0; i < 700 && failures == start; i++) {
+            int kind = i % 7;
+            int16_t v[4];
+            for (int j = 0; j < 4; j++) {
+                v[j] = (int16_t)(rand() % (j & 1 ? 160 : 240)) - (j & 1 ? 48 : 56);
+            }
+
+            ssd1306_reset_clip(&display);
+            ssd1306_clear(&display);
+            draw_random_primitive(kind, v, &sprite);
+            memcpy(whole, display.buffer, sizeof(whole));
+
+            ssd1306_set_clip(&display, clip[0], clip[1], clip[2], clip[3]);
+            ssd1306_clear(&display);
+            draw_random_primitive(kind, v, &sprite);
+
+            for (int16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+                for (int16_t x = 0; x < DISPLAY_WIDTH; x++) {
+                    bool inside = x >= clip[0] && x < clip[0] + clip[2] && y >= clip[1] && y < clip[1] + clip[3];
+                    bool expected = inside && buffer_pixel(whole, x, y);
+                    if (buffer_pixel(display.buffer, x, y) != expected) {
+                        printf("FAIL clip: primitive %d (%d, %d, %d, %d) in clip %zu, pixel %d,%d\n",
+                               kind, v[0], v[1], v[2], v[3], c, x, y);
+                        failures++;
+                        x = DISPLAY_WIDTH;
+                        y = DISPLAY_HEIGHT;
+                    }
+                }
+            }
+        }
+    }
+    ssd1306_reset_clip(&display);
+    if (failures == start) printf("ok   clip\n");
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            golden_dir = argv[i];
+        }
+    }
+    if (!golden_dir) {
+        fprintf(stderr, "usage: %s [--update] <golden-dir>\n", argv[0]);
+        return 2;
+    }
+
+    test_screens();
+    test_transitions();
+    test_slide_timing();
+    test_slide_interrupt();
+    test_partial_flush();
+    test_state_frames();
+    test_spi_bus();
+    test_mirror();
+    test_power();
+#if ENABLE_TRACE
+    test_trace();
+#endif
+    test_perf_counters();
+    test_boot();
+    test_bus_faults();
+    test_clip();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
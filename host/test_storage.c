@@ -0,0 +1,177 @@
+// State log tests: picking the newest record, skipping damaged ones,
+// reclaiming sectors, the legacy fallback and urgent write-behind
+// commits, against the mock flash.
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "config.h"
+#include "perf.c"
+#include "trace.c"
+#include "storage.c"
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { printf("FAIL " __VA_ARGS__); printf("\n"); failures++; } \
+} while (0)
+
+// What a power cycle leaves: flash only
+static void reboot(void) {
+    storage_scanned = false;
+    storage_seq = 0;
+    storage_next_slot = 0;
+    storage_have_last = false;
+}
+
+// Write a record straight into the mock flash, as an earlier boot would have
+static void put_record(uint32_t slot, uint32_t seq, uint8_t current, uint8_t turns) {
+    save_record_t rec = {0};
+    rec.magic = SAVE_MAGIC;
+    rec.seq = seq;
+    rec.current = current;
+    rec.turns = turns;
+    rec.crc = storage_crc32((const uint8_t *)&rec, offsetof(save_record_t, crc));
+    memcpy(mock_flash + FLASH_TARGET_OFFSET + slot * SAVE_RECORD_SIZE, &rec, sizeof(rec));
+}
+
+static void test_seq_wrap(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    // The sequence number wrapped in the middle of the log
+    put_record(0, 0xFFFFFFFE, 0, 1);
+    put_record(1, 0xFFFFFFFF, 1, 2);
+    put_record(2, 0, 0, 3);
+    put_record(3, 1, 1, 0);
+
+    uint8_t current = 0xFF, turns = 0xFF;
+    CHECK(load_state(&current, &turns), "seq wrap: nothing loaded");
+    CHECK(current == 1 && turns == 0, "seq wrap: loaded %u/%u, expected 1/0", current, turns);
+
+    CHECK(save_state(0, 1), "seq wrap: save failed");
+    const save_record_t *rec = storage_slot(4);
+    CHECK(storage_record_valid(rec) && rec->seq == 2, "seq wrap: next record seq %u", rec->seq);
+    if (failures == start) printf("ok   storage seq wrap\n");
+}
+
+static void test_bad_crc(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    // The newest record was damaged after it was written
+    put_record(0, 1, 0, 2);
+    put_record(1, 2, 1, 3);
+    mock_flash[FLASH_TARGET_OFFSET + SAVE_RECORD_SIZE + offsetof(save_record_t, turns)] ^= 0x01;
+
+    uint8_t current = 0xFF, turns = 0xFF;
+    CHECK(load_state(&current, &turns), "bad crc: nothing loaded");
+    CHECK(current == 0 && turns == 2, "bad crc: loaded %u/%u, expected 0/2", current, turns);
+
+    // The damaged slot is not reused without an erase
+    CHECK(save_state(1, 1), "bad crc: save failed");
+    const save_record_t *rec = storage_slot(2);
+    CHECK(storage_record_valid(rec) && rec->seq == 2 && rec->turns == 1,
+          "bad crc: next record not in slot 2");
+    if (failures == start) printf("ok   storage bad crc\n");
+}
+
+static void test_sector_roll(void) {
+    int start = failures;
+    mock_reset();
+    perf_reset();
+    reboot();
+
+    // Fill the whole log, then one more: only the first sector, now the
+    // oldest, is erased to take it
+    for (uint32_t i = 0; i < SAVE_RECORDS_TOTAL; i++) {
+        CHECK(save_state(i & 1, i % 4), "sector roll: save %u failed", i);
+    }
+    CHECK(perf_stats[PERF_SAVE_ERASE].count == 0, "sector roll: %u erases filling a blank log",
+          perf_stats[PERF_SAVE_ERASE].count);
+    CHECK(save_state(1, 2), "sector roll: save failed");
+    CHECK(perf_stats[PERF_SAVE_ERASE].count == 1, "sector roll: %u erases",
+          perf_stats[PERF_SAVE_ERASE].count);
+
+    const save_record_t *rec = storage_slot(0);
+    CHECK(storage_record_valid(rec) && rec->seq == SAVE_RECORDS_TOTAL + 1, "sector roll: slot 0 seq %u",
+          rec->seq);
+    CHECK(storage_slot_blank(1) && storage_slot_blank(SAVE_RECORDS_PER_SECTOR - 1),
+          "sector roll: first sector not erased");
+    CHECK(storage_record_valid(storage_slot(SAVE_RECORDS_PER_SECTOR)), "sector roll: second sector erased");
+
+    // The rest of the sector fills without another erase, also after a reboot
+    reboot();
+    uint8_t current = 0xFF, turns = 0xFF;
+    CHECK(load_state(&current, &turns) && current == 1 && turns == 2,
+          "sector roll: loaded %u/%u after reboot", current, turns);
+    CHECK(save_state(0, 3), "sector roll: save after reboot failed");
+    CHECK(storage_record_valid(storage_slot(1)), "sector roll: next record not in slot 1");
+    CHECK(perf_stats[PERF_SAVE_ERASE].count == 1, "sector roll: erased again after reboot");
+    if (failures == start) printf("ok   storage sector roll\n");
+}
+
+static void test_legacy(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    uint8_t current = 0xFF, turns = 0xFF;
+    CHECK(!load_state(&current, &turns), "legacy: loaded from blank flash");
+
+    // Only the single record older firmware kept
+    legacy_save_data_t legacy = {.magic = SAVE_MAGIC, .current = 1, .turns = 3};
+    memcpy(mock_flash + LEGACY_OFFSET, &legacy, sizeof(legacy));
+    reboot();
+    CHECK(load_state(&current, &turns), "legacy: nothing loaded");
+    CHECK(current == 1 && turns == 3, "legacy: loaded %u/%u, expected 1/3", current, turns);
+
+    // The first save starts the log, which wins from then on
+    CHECK(save_state(0, 1), "legacy: save failed");
+    CHECK(storage_record_valid(storage_slot(0)), "legacy: record not in slot 0");
+    reboot();
+    CHECK(load_state(&current, &turns) && current == 0 && turns == 1,
+          "legacy: loaded %u/%u after a save", current, turns);
+    if (failures == start) printf("ok   storage legacy\n");
+}
+
+static void test_urgent(void) {
+    int start = failures;
+    mock_reset();
+    reboot();
+
+    persist_state(1, 2);
+    persist_poll();
+    CHECK(storage_slot_blank(0), "urgent: committed during the idle window");
+
+    // Committed by the next poll, with no time passing
+    persist_request_urgent();
+    persist_poll();
+    const save_record_t *rec = storage_slot(0);
+    CHECK(storage_record_valid(rec) && rec->current == 1 && rec->turns == 2, "urgent: not committed");
+    CHECK(!persist_pending(), "urgent: still pending");
+
+    // Only that commit: the next change waits out its idle window again
+    persist_state(0, 3);
+    persist_poll();
+    CHECK(storage_slot_blank(1), "urgent: next change committed early");
+    mock_advance_us(SAVE_IDLE_MS * 1000);
+    persist_poll();
+    CHECK(storage_record_valid(storage_slot(1)), "urgent: next change not committed");
+    if (failures == start) printf("ok   storage urgent\n");
+}
+
+int main(void) {
+    test_seq_wrap();
+    test_bad_crc();
+    test_sector_roll();
+    test_legacy();
+    test_urgent();
+
+    if (failures) {
+        printf("%d failure(s)\n", failures);
+        return 1;
+    }
+    return 0;
+}
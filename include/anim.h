@@ -0,0 +1,69 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "ssd1306.h"
+
+// Compressed animation frames, built by tools/gen_anim_assets.py. A frame
+// is a delta against the frame before it: the window of GDDRAM that
+// changed (x0, x1, page0, page1; page0 = ANIM_NO_CHANGE if nothing did),
+// then the window's bytes page by page as RLE tokens:
+//   0x00-0x7F  literal, token + 1 bytes follow
+//   0x80-0xFF  run of token - 0x80 + ANIM_RUN_MIN copies of the next byte
+#define ANIM_RUN_MIN 3
+#define ANIM_NO_CHANGE 0xFF
+
+// Resumable RLE decoder, expanding into I2C DATA_CMD words
+typedef struct {
+    const uint8_t *src;
+    uint8_t run_value;
+    uint8_t run_left;
+    uint8_t literal_left;
+} anim_decoder_t;
+
+static void anim_decoder_init(anim_decoder_t *dec, const uint8_t *rle);
+static uint16_t anim_decode(void *dec, uint16_t *out, uint16_t max);
+
+// Send one frame to the panel, decoding chunk by chunk into the transmit
+// path. The panel must show the frame the delta was built against.
+static void anim_stream_frame(ssd1306_t *display, const uint8_t *frame);
+
+// Write one frame's window into the display buffer instead and mark it
+// dirty, so several deltas applied in order go out as one flush
+static void anim_apply_frame(ssd1306_t *display, const uint8_t *frame);
+
+// Animation clock. A repeating timer ticks at the frame rate and wakes the
+// renderer (SEV); each frame's position comes from the time elapsed since
+// the start through an easing curve, so an animation lasts the same time
+// whatever each frame costs. Progress is fixed point, 0 to ANIM_ONE.
+#define ANIM_ONE 0x10000
+
+typedef enum {
+    ANIM_EASE_LINEAR,
+    ANIM_EASE_IN_OUT,   // Smoothstep: gentle start and finish
+    ANIM_EASE_OUT,      // Cubic: quick start, settles gently
+} anim_ease_t;
+
+typedef struct {
+    absolute_time_t start;
+    uint32_t duration_us;
+    uint32_t frame_us;
+    anim_ease_t ease;
+    repeating_timer_t timer;
+    volatile bool tick;   // Set by the timer, cleared by anim_clock_take_tick()
+    uint32_t last_frame;  // Tick number of the last frame drawn
+} anim_clock_t;
+
+static uint32_t anim_ease(anim_ease_t ease, uint32_t t);
+static void anim_clock_start(anim_clock_t *clock, uint32_t duration_ms, uint32_t frame_ms, anim_ease_t ease);
+static void anim_clock_stop(anim_clock_t *clock);
+static bool anim_clock_take_tick(anim_clock_t *clock);
+static absolute_time_t anim_clock_next_tick(const anim_clock_t *clock);
+
+// Start a frame: false once the duration is up, otherwise the eased
+// progress for now. Ticks passed since the previous frame count as dropped.
+static bool anim_clock_frame(anim_clock_t *clock, uint32_t *progress);
+
+#endif // ANIM_H
@@ -0,0 +1,34 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Debounced button input. GPIO edge IRQs report a press or release the
+// moment the first edge arrives, then ignore the pin for
+// BUTTON_DEBOUNCE_MS; an alarm at the end of that window re-samples the
+// pin and reports any change that happened while it was locked out.
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS 20
+#endif
+
+// Events queued between the IRQs and the main loop (power of two)
+#define BUTTON_QUEUE_SIZE 16
+
+typedef enum {
+    BUTTON_TAKE,
+    BUTTON_DEFER,
+    BUTTON_COUNT,
+} button_id_t;
+
+typedef struct {
+    uint8_t button;     // button_id_t
+    bool pressed;       // true on press, false on release
+    uint32_t time_us;   // Time of the edge that triggered the event
+} button_event_t;
+
+static void buttons_init(void);
+static bool buttons_poll(button_event_t *event);
+static bool buttons_event_pending(void);
+
+#endif // BUTTONS_H
@@ -3,6 +3,10 @@
 
 // Feature flags
 #define ENABLE_DISPLAY 1
+// Press-to-pixel event trace (trace.h); 4 KB of RAM
+#ifndef ENABLE_TRACE
+#define ENABLE_TRACE 1
+#endif
 
 // LED Configuration (GP25 is the onboard LED on Pico)
 #define LED_PIN 25
@@ -11,16 +15,114 @@
 #define I2C_PORT i2c0
 #define I2C_SDA_PIN 4
 #define I2C_SCL_PIN 5
-#define I2C_BAUDRATE 400000  // 400 kHz
+// Fast-mode Plus (1 MHz) for panels and wiring that tolerate it; needs
+// stronger pull-ups than the internal ones (e.g. 2.2k to 3V3)
+#define I2C_FAST_MODE_PLUS 0
+#if I2C_FAST_MODE_PLUS
+#define I2C_BAUDRATE 1000000  // 1 MHz
+#else
+#define I2C_BAUDRATE 400000   // 400 kHz
+#endif
+
+// 4-wire SPI panels instead (ssd1306_spi.h): hardware SPI with DMA at up
+// to 10 MHz, a full frame in about 1 ms against 23 ms on 400 kHz I2C
+#define DISPLAY_BUS_SPI 0
+#define SPI_PORT spi0
+#define SPI_SCK_PIN 18
+#define SPI_MOSI_PIN 19
+#define SPI_CS_PIN 17
+#define SPI_DC_PIN 20
+#define SPI_RESET_PIN 21     // SSD1306_SPI_NO_RESET if RES is tied high
+#define SPI_BAUDRATE 10000000
 
 // SSD1315/SSD1306 Display Configuration
 // Note: Display VCC needs 5V (VBUS pin 40), not 3.3V
+// 128x64, 128x32 or 72x40; the driver and the layout are built for it
+// (the host build overrides both to test every size)
+#ifndef DISPLAY_WIDTH
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 64
+#endif
+#define SSD1306_WIDTH DISPLAY_WIDTH
+#define SSD1306_HEIGHT DISPLAY_HEIGHT
 #define DISPLAY_I2C_ADDR 0x3C
+// From power-on until the panel takes commands: VDD settled and the
+// module's RC reset released (SPI panels are also reset through RES).
+// Counted from reset; the first frame is read from flash meanwhile.
+#define DISPLAY_POWER_UP_MS 10
+
+// Second panel showing the same screen, drawn from the same buffer. On the
+// other I2C controller both flush at once; on I2C_PORT it needs the other
+// address (0x3D) and the two take turns. I2C displays only.
+#ifndef DISPLAY_MIRROR
+#define DISPLAY_MIRROR 0
+#endif
+#define MIRROR_I2C_PORT i2c1
+#define MIRROR_I2C_SDA_PIN 6  // Unused when MIRROR_I2C_PORT is I2C_PORT
+#define MIRROR_I2C_SCL_PIN 7
+#define MIRROR_I2C_ADDR 0x3C
+#if DISPLAY_MIRROR && DISPLAY_BUS_SPI
+#error "DISPLAY_MIRROR needs the display on I2C"
+#endif
+
+// Serve the static screens (each name at 1-3 turns) from frames
+// pre-rendered into flash at build time instead of rasterizing them
+#define DISPLAY_STATE_FRAMES 1
+
+// Play slides between names from compressed frames built into flash
+// (tools/gen_anim_assets.py) instead of compositing them at runtime;
+// ignored with DISPLAY_HW_SCROLL
+#define DISPLAY_ANIM_ASSETS 1
+
+// Slide transitions with the controller's content-scroll command: GDDRAM is
+// shifted on the panel and only the incoming column is sent over I2C.
+// Content scroll (0x2C/0x2D) is an SSD1315 command that a plain SSD1306
+// does not have, so this also needs DISPLAY_SSD1315. The panel shifts one
+// column per frame at most, so such a slide takes DISPLAY_SCROLL_COLUMN_MS
+// per column (about 1.3 s at 128 wide) instead of DISPLAY_SLIDE_MS; a newer
+// press still cuts it short at the next column.
+#ifndef DISPLAY_HW_SCROLL
+#define DISPLAY_HW_SCROLL 0
+#endif
+#define DISPLAY_SCROLL_COLUMN_MS 10
+// The panel's controller is an SSD1315 rather than an SSD1306
+#ifndef DISPLAY_SSD1315
+#define DISPLAY_SSD1315 0
+#endif
+#if DISPLAY_HW_SCROLL && !DISPLAY_SSD1315
+#error "DISPLAY_HW_SCROLL needs the SSD1315's content scroll (DISPLAY_SSD1315)"
+#endif
+
+// Slides take DISPLAY_SLIDE_MS of wall-clock time at any bus speed, along
+// the DISPLAY_SLIDE_EASE curve (anim.h). A frame is drawn every
+// DISPLAY_FRAME_MS; ticks that arrive while a flush is still going are
+// dropped.
+#define DISPLAY_SLIDE_MS 300
+#define DISPLAY_FRAME_MS 25
+#define DISPLAY_SLIDE_EASE ANIM_EASE_IN_OUT
+
+// Persistent state log: number of 4 KB sectors at the end of flash
+#define STORAGE_SECTORS 4
+// Commit state to flash after this long without a change
+#define SAVE_IDLE_MS 2000
+// The console's `reboot` resets the chip this long after the last save
+#define WATCHDOG_REBOOT_DELAY_MS 10
+// Turn-history journal: 4 KB sectors just below the state log (256 events each)
+#define JOURNAL_SECTORS 16
+
+// Idle power saving (power.h); 0 skips a stage. Dormant wakes on either
+// button but not over USB.
+#define POWER_DIM_MS 20000
+#define POWER_OFF_MS 60000
+#define POWER_DORMANT_MS 600000
+#define POWER_DIM_CONTRAST 0x08
+// clk_sys while the panel is off (0 keeps full speed)
+#define POWER_SLOW_CLOCK_KHZ 48000
+#define POWER_FULL_CLOCK_KHZ 125000
 
 // Button Configuration
 #define BUTTON_PIN 15        // Take turn (GP15, pin 20)
 #define DEFER_BUTTON_PIN 14  // Defer/add turn (GP14, pin 19)
+#define BUTTON_DEBOUNCE_MS 20
 
 #endif // CONFIG_H
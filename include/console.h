@@ -0,0 +1,21 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Line-based command console on USB stdio, polled from the main loop
+// without blocking. Commands are matched against the table in console.c.
+#define CONSOLE_LINE_MAX 32
+
+typedef struct {
+    const char *name;
+    const char *help;
+    void (*run)(void);
+} console_cmd_t;
+
+static void console_poll(void);
+// Set by the `reboot` command; main.c saves what is pending and restarts
+static bool console_reboot_requested;
+
+#endif // CONSOLE_H
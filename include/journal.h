@@ -0,0 +1,61 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "storage.h"
+
+// Turn history: an append-only ring of fixed-size records in its own
+// JOURNAL_SECTORS sectors just below the state log. Like the state log,
+// records are programmed into erased slots and a sector is only erased
+// when the ring wraps onto it, so there is no erase per event. Events are
+// queued in RAM and committed a page at a time once input has settled.
+#ifndef JOURNAL_SECTORS
+#define JOURNAL_SECTORS 16
+#endif
+
+#define JOURNAL_OFFSET (FLASH_TARGET_OFFSET - JOURNAL_SECTORS * FLASH_SECTOR_SIZE)
+
+typedef enum {
+    JOURNAL_BOOT = 1,   // Powered up showing `name` with `turns`
+    JOURNAL_TAKE,       // `name` took a turn, `turns` left (0: passed on)
+    JOURNAL_DEFER,      // `name` deferred, now has `turns`
+} journal_event_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;       // Increments with every record, newest wins
+    uint32_t time_ms;   // Since boot
+    uint16_t boot;      // Boot counter, one more than the previous boot's
+    uint8_t event;      // journal_event_t
+    uint8_t name;       // Index into names[]
+    uint8_t turns;
+    uint8_t reserved;
+    uint16_t crc;       // Low half of the CRC-32 of the fields above
+} journal_record_t;
+
+#define JOURNAL_RECORD_SIZE sizeof(journal_record_t)
+#define JOURNAL_RECORDS_PER_PAGE (FLASH_PAGE_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_RECORDS_PER_SECTOR (FLASH_SECTOR_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_RECORDS_TOTAL (JOURNAL_SECTORS * JOURNAL_RECORDS_PER_SECTOR)
+
+// Events waiting in RAM for journal_flush()
+#define JOURNAL_QUEUE_SIZE 32
+
+// Export framing, little-endian: JOURNAL_EXPORT_MAGIC, version, record
+// size, uint16 reserved, uint32 record count, the valid records oldest
+// first exactly as stored, then the CRC-32 of the record bytes.
+// tools/journal_decode.py reads it.
+#define JOURNAL_EXPORT_MAGIC "TTJL"
+#define JOURNAL_EXPORT_VERSION 1
+
+// journal_append() only queues the event; journal_poll() commits the queue
+// once the state log has committed (the same SAVE_IDLE_MS window) or a
+// page's worth is waiting. journal_flush() commits immediately.
+static void journal_append(journal_event_t event, uint8_t name, uint8_t turns);
+static void journal_poll(void);
+static void journal_flush(void);
+
+// Stream the whole journal over USB CDC in the export framing
+static void journal_export(void);
+
+#endif // JOURNAL_H
@@ -0,0 +1,51 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Always-on timing statistics, dumped over the USB console. Each timed
+// stat keeps count/min/avg/max and a log2 histogram of durations in us
+// (bin n holds 2^(n-1)..2^n - 1 us, the last bin everything longer).
+#define PERF_HIST_BINS 16
+
+typedef enum {
+    PERF_BUS_WRITE,     // One blocking command transaction to the panel
+    PERF_RENDER,        // Rasterizing a frame into the buffer
+    PERF_FLUSH,         // Flush start until the last byte left the bus
+    PERF_SAVE_ERASE,    // Flash sector erase in save_state()
+    PERF_SAVE_PROGRAM,  // Flash page program in save_state()
+    PERF_LOOP,          // Busy time of one main loop iteration (wake to sleep)
+    PERF_WAKE,          // Wake from display off until the panel shows the last frame
+    PERF_COUNT,
+} perf_id_t;
+
+// Display bus failures and what was done about them
+typedef enum {
+    PERF_FAULT_NAK,       // Panel didn't acknowledge a transaction
+    PERF_FAULT_TIMEOUT,   // Transfer overran its deadline
+    PERF_FAULT_RETRY,     // Command transaction sent again
+    PERF_FAULT_RECOVERY,  // Bus clocked free and controller reset
+    PERF_FAULT_REINIT,    // Panel re-initialized after a failure
+    PERF_FAULT_COUNT,
+} perf_fault_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PERF_HIST_BINS];
+} perf_stat_t;
+
+// Each stat is only written from one core; perf_reset() from core 0 can
+// race a sample being recorded on core 1, which at worst loses it
+static void perf_record(perf_id_t id, uint32_t us);
+// A transaction to the panel, `bytes` as they go on the wire
+static void perf_count_bus(uint32_t bytes);
+static void perf_count_frame(uint32_t dropped);
+static void perf_count_fault(perf_fault_t fault);
+static void perf_reset(void);
+static void perf_print(void);
+
+#endif // PERF_H
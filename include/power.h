@@ -0,0 +1,32 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "buttons.h"
+
+// Idle policy for battery units. After POWER_DIM_MS without input the panel
+// dims; after POWER_OFF_MS it sleeps and clk_sys drops to
+// POWER_SLOW_CLOCK_KHZ; after POWER_DORMANT_MS the chip goes dormant
+// until a button edge. A stage set to 0 is skipped. Dormant stops every
+// clock including USB, so it is also skipped while a USB host is attached.
+//
+// The panel keeps its last frame through all of it, so waking only has to
+// turn it back on; the time from the wake edge to that point is the `wake`
+// stat on the console. A press that wakes the panel from off or dormant
+// is used up by the wake and does not take or defer a turn.
+typedef enum {
+    POWER_ACTIVE,
+    POWER_DIMMED,
+    POWER_DISPLAY_OFF,  // With clk_sys slowed down
+    POWER_DORMANT,
+} power_state_t;
+
+static void power_init(void);
+// Feed every button event through here first; true if it was used up
+// waking the device
+static bool power_input(const button_event_t *event);
+// Step down once the idle deadlines pass. Returns after a dormant wake.
+static void power_poll(void);
+
+#endif // POWER_H
@@ -0,0 +1,52 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+// The UI is drawn and flushed on core 1. Core 0 only posts commands;
+// the renderer always jumps to the newest one. A newer turn count for the
+// name sliding in retargets a running slide; any other command cuts it
+// short.
+#define RENDER_QUEUE_SIZE 8  // Power of two
+
+typedef enum {
+    RENDER_SHOW,        // Draw a screen
+    RENDER_TRANSITION,  // Slide from one name to the next
+} render_cmd_type_t;
+
+// Panel power, applied by the renderer before it draws anything else
+typedef enum {
+    RENDER_POWER_ON,    // Normal contrast
+    RENDER_POWER_DIM,   // Contrast down to POWER_DIM_CONTRAST
+    RENDER_POWER_OFF,   // Sleep mode; the panel keeps the last frame
+} render_power_t;
+
+// Commands are packed into one word: type, old index, new index, turns
+#define RENDER_CMD(type, old_index, new_index, turns) \
+    (((uint32_t)(type) << 24) | ((uint32_t)(old_index) << 16) | ((uint32_t)(new_index) << 8) | (turns))
+#define RENDER_CMD_TYPE(cmd)  ((cmd) >> 24)
+#define RENDER_CMD_OLD(cmd)   (((cmd) >> 16) & 0xFF)
+#define RENDER_CMD_NEW(cmd)   (((cmd) >> 8) & 0xFF)
+#define RENDER_CMD_TURNS(cmd) ((cmd) & 0xFF)
+
+// Core 0
+static void renderer_start(void);
+static void renderer_show(uint8_t name_index, uint8_t turns);
+static void renderer_transition(uint8_t old_index, uint8_t new_index, uint8_t turns);
+static void renderer_pump(void);
+// `since_us`: when the wake started, for the PERF_WAKE stat on leaving
+// RENDER_POWER_OFF
+static void renderer_set_power(render_power_t level, uint32_t since_us);
+static bool renderer_power_settled(void);
+// clk_sys (and clk_peri with it) has changed: set the bus dividers back to
+// their configured rates and hand the driver the rates they achieve, which
+// its transfer deadlines are worked out from. Only while the panel is off
+// and the renderer has settled.
+static void renderer_clock_changed(void);
+
+// Core 1
+static bool render_superseded(void);
+
+#endif // RENDERER_H
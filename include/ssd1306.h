@@ -3,9 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "hardware/i2c.h"
+#include "ssd1306_bus.h"
+#include "ssd1306.hpp"
 
-// Display dimensions (can be overridden)
+// Display dimensions (can be overridden). The driver is built for one
+// panel size, so buffer offsets and bounds are constants.
 #ifndef SSD1306_WIDTH
 #define SSD1306_WIDTH 128
 #endif
@@ -14,33 +16,71 @@
 #define SSD1306_HEIGHT 64
 #endif
 
+// C API: the driver instantiated for this panel size, each call forwarding
+// to the member of the same name (documented in ssd1306.hpp)
+typedef Ssd1306<SSD1306_WIDTH, SSD1306_HEIGHT, ssd1306_bus_t> ssd1306_t;
+typedef ssd1306_t::cmd_list ssd1306_cmd_list_t;
+
 // Buffer size for the display
 #define SSD1306_BUFFER_SIZE (SSD1306_WIDTH * SSD1306_HEIGHT / 8)
+#define SSD1306_PAGES (SSD1306_HEIGHT / 8)
+
+// Command list (SSD1306_CMD_LIST_MAX bytes, sent as one transaction)
+static void ssd1306_cmd_begin(ssd1306_cmd_list_t *list, ssd1306_t *display);
+static void ssd1306_cmd_append(ssd1306_cmd_list_t *list, const uint8_t *cmd, uint8_t len);
+static void ssd1306_cmd_send(ssd1306_cmd_list_t *list);
 
-// SSD1306 display structure
-typedef struct {
-    i2c_inst_t *i2c;
-    uint8_t addr;
-    uint8_t width;
-    uint8_t height;
-    uint8_t buffer[SSD1306_BUFFER_SIZE];
-} ssd1306_t;
+// Append one command with its argument bytes
+#define ssd1306_cmd_push(list, ...) (list)->push(__VA_ARGS__)
 
 // Initialization and control
-static void ssd1306_init(ssd1306_t *display, i2c_inst_t *i2c, uint8_t addr, uint8_t width, uint8_t height);
+static void ssd1306_init(ssd1306_t *display, ssd1306_bus_t *bus);
+static void ssd1306_attach(ssd1306_t *display, ssd1306_bus_t *bus);
+static void ssd1306_configure(ssd1306_t *display, bool on);
+static void ssd1306_add_panel(ssd1306_t *display, ssd1306_bus_t *bus);
 static void ssd1306_display(ssd1306_t *display);
+static void ssd1306_display_async(ssd1306_t *display);
+static void ssd1306_display_frame(ssd1306_t *display, const uint16_t *frame);
+static bool ssd1306_panel_matches(ssd1306_t *display, const uint16_t *frame);
+static void ssd1306_display_stream(ssd1306_t *display, uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1,
+                                   ssd1306_stream_fill_t fill, void *ctx);
+static bool ssd1306_busy(ssd1306_t *display);
+static void ssd1306_wait(ssd1306_t *display);
 static void ssd1306_clear(ssd1306_t *display);
 static void ssd1306_set_contrast(ssd1306_t *display, uint8_t contrast);
+static void ssd1306_sleep(ssd1306_t *display);
+static void ssd1306_wake(ssd1306_t *display, uint8_t contrast);
 static void ssd1306_invert(ssd1306_t *display, bool invert);
 
+// Hardware scroll
+static void ssd1306_scroll_start(ssd1306_t *display, bool left, uint8_t page0, uint8_t page1, uint8_t interval);
+static void ssd1306_scroll_stop(ssd1306_t *display);
+static void ssd1306_scroll_content(ssd1306_t *display, bool left, uint8_t x0, uint8_t x1,
+                                   uint8_t page0, uint8_t page1);
+
+// Dirty-region tracking and clipping
+static void ssd1306_mark_dirty(ssd1306_t *display, int16_t x0, int16_t x1, int16_t page0, int16_t page1);
+static void ssd1306_invalidate(ssd1306_t *display);
+static void ssd1306_set_clip(ssd1306_t *display, int16_t x, int16_t y, int16_t w, int16_t h);
+static void ssd1306_reset_clip(ssd1306_t *display);
+
 // Drawing primitives
 static void ssd1306_draw_pixel(ssd1306_t *display, int16_t x, int16_t y, bool color);
+static void ssd1306_draw_hline(ssd1306_t *display, int16_t x, int16_t y, int16_t w, bool color);
+static void ssd1306_draw_vline(ssd1306_t *display, int16_t x, int16_t y, int16_t h, bool color);
 static void ssd1306_draw_line(ssd1306_t *display, int16_t x0, int16_t y0, int16_t x1, int16_t y1, bool color);
 static void ssd1306_draw_rect(ssd1306_t *display, int16_t x, int16_t y, int16_t w, int16_t h, bool color);
 static void ssd1306_fill_rect(ssd1306_t *display, int16_t x, int16_t y, int16_t w, int16_t h, bool color);
 
+// Sprites
+static void ssd1306_blit(ssd1306_t *display, const ssd1306_sprite_t *sprite, int16_t x, int16_t y, ssd1306_blit_mode_t mode);
+static void ssd1306_sprite_capture(ssd1306_t *display, ssd1306_sprite_t *sprite, uint8_t *data,
+                                   int16_t x, int16_t page, int16_t w, int16_t pages);
+
 // Text rendering
 static void ssd1306_draw_char(ssd1306_t *display, int16_t x, int16_t y, char c, bool color);
 static void ssd1306_draw_string(ssd1306_t *display, int16_t x, int16_t y, const char *str, bool color);
+static void ssd1306_draw_string_scaled(ssd1306_t *display, int16_t x, int16_t y, const char *str, uint8_t scale,
+                                       bool color);
 
 #endif // SSD1306_H
@@ -0,0 +1,1055 @@
+#ifndef SSD1306_HPP
+#define SSD1306_HPP
+
+// SSD1306/SSD1315 driver, header-only C++17. Ssd1306<Width, Height, Bus>
+// is built for one panel size: the geometry, how the panel is wired and
+// the draw_content() layout are constants, so buffer offsets, strides and
+// bounds fold into the code. `Bus` is the transport (ssd1306_bus.h): its
+// `ops` table and busy/aborted/port flags. The C API (ssd1306.h) wraps
+// the one instantiation the firmware is configured for.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "ssd1306_bus.h"
+#include "perf.h"
+#include "font5x7.h"
+#include "font_scaled.h"
+
+// SSD1306 Commands
+#define SSD1306_SET_CONTRAST        0x81
+#define SSD1306_DISPLAY_ALL_ON_RESUME 0xA4
+#define SSD1306_DISPLAY_ALL_ON      0xA5
+#define SSD1306_NORMAL_DISPLAY      0xA6
+#define SSD1306_INVERT_DISPLAY      0xA7
+#define SSD1306_DISPLAY_OFF         0xAE
+#define SSD1306_DISPLAY_ON          0xAF
+#define SSD1306_SET_DISPLAY_OFFSET  0xD3
+#define SSD1306_SET_COM_PINS        0xDA
+#define SSD1306_SET_VCOM_DETECT     0xDB
+#define SSD1306_SET_DISPLAY_CLOCK   0xD5
+#define SSD1306_SET_PRECHARGE       0xD9
+#define SSD1306_SET_MULTIPLEX       0xA8
+#define SSD1306_SET_LOW_COLUMN      0x00
+#define SSD1306_SET_HIGH_COLUMN     0x10
+#define SSD1306_SET_START_LINE      0x40
+#define SSD1306_MEMORY_MODE         0x20
+#define SSD1306_COLUMN_ADDR         0x21
+#define SSD1306_PAGE_ADDR           0x22
+#define SSD1306_COM_SCAN_INC        0xC0
+#define SSD1306_COM_SCAN_DEC        0xC8
+#define SSD1306_SEG_REMAP           0xA0
+#define SSD1306_CHARGE_PUMP         0x8D
+#define SSD1306_SET_IREF            0xAD
+#define SSD1306_RIGHT_SCROLL        0x26
+#define SSD1306_LEFT_SCROLL         0x27
+#define SSD1306_CONTENT_SCROLL_RIGHT 0x2C
+#define SSD1306_CONTENT_SCROLL_LEFT 0x2D
+#define SSD1306_DEACTIVATE_SCROLL   0x2E
+#define SSD1306_ACTIVATE_SCROLL     0x2F
+
+// Most panels one display can be mirrored onto (add_panel())
+#ifndef SSD1306_MAX_PANELS
+#define SSD1306_MAX_PANELS 2
+#endif
+
+// Contrast set by init()
+#define SSD1306_DEFAULT_CONTRAST 0xCF
+
+// Command list: commands pushed onto it go out together in a single bus
+// transaction (one START/address/STOP, or one CS assertion) when sent
+#define SSD1306_CMD_LIST_MAX 32
+#define SSD1306_ALL_PANELS 0xFF
+
+// Words display_stream() stages at a time
+#define SSD1306_STREAM_CHUNK 64
+
+// 1bpp image in the panel's page format: ceil(height / 8) rows of `width`
+// column bytes, bit 0 at the top of each page. Padding bits below
+// `height` in the last page must be zero.
+typedef struct {
+    const uint8_t *data;
+    int16_t width;
+    int16_t height;
+} ssd1306_sprite_t;
+
+typedef enum {
+    SSD1306_BLIT_SET,    // Set pixels where the sprite has ink
+    SSD1306_BLIT_CLEAR,  // Clear pixels where the sprite has ink
+    SSD1306_BLIT_XOR,    // Toggle pixels where the sprite has ink
+} ssd1306_blit_mode_t;
+
+// Writes the next `max` GDDRAM bytes of a streamed window as DATA_CMD
+// words and returns how many it wrote
+typedef uint16_t (*ssd1306_stream_fill_t)(void *ctx, uint16_t *out, uint16_t max);
+
+// How a panel is wired to the controller: its COM pin layout, and the
+// first of the 128 columns it shows (narrow glass sits in the middle).
+// The 0.42" 72x40 modules also need the internal reference.
+typedef struct {
+    uint8_t com_pins;
+    uint8_t column_offset;
+    bool internal_iref;
+} ssd1306_wiring_t;
+
+// draw_content() layout (src/renderer.c), top to bottom: rule, name,
+// rule, dots. Only the centering depends on the name and turn count.
+typedef struct {
+    uint8_t name_scale;
+    uint8_t line_y1;
+    uint8_t name_y;
+    uint8_t line_y2;
+    uint8_t dots_y;
+    uint8_t dot_size;
+    uint8_t dot_spacing;
+} ssd1306_layout_t;
+
+template <int Width, int Height>
+constexpr bool ssd1306_supported() {
+    return (Width == 128 && Height == 64) || (Width == 128 && Height == 32) || (Width == 72 && Height == 40);
+}
+
+template <int Width, int Height>
+constexpr ssd1306_wiring_t ssd1306_wiring() {
+    ssd1306_wiring_t w{};
+    if constexpr (Width == 128 && Height == 64) {
+        w.com_pins = 0x12;  // Alternative, no left/right remap
+    } else if constexpr (Width == 128 && Height == 32) {
+        w.com_pins = 0x02;  // Sequential
+    } else if constexpr (Width == 72 && Height == 40) {
+        w.com_pins = 0x12;
+        w.column_offset = 28;
+        w.internal_iref = true;
+    }
+    return w;
+}
+
+// One layout per panel size (tools/gen_state_frames.py reads these)
+template <int Width, int Height>
+constexpr ssd1306_layout_t ssd1306_layout() {
+    ssd1306_layout_t l{};
+    if constexpr (Width == 128 && Height == 64) {
+        l.name_scale = 3;
+        l.line_y1 = 10;
+        l.name_y = 16;
+        l.line_y2 = 41;
+        l.dots_y = 49;
+        l.dot_size = 6;
+        l.dot_spacing = 10;
+    } else if constexpr (Width == 128 && Height == 32) {
+        l.name_scale = 2;
+        l.line_y1 = 4;
+        l.name_y = 7;
+        l.line_y2 = 22;
+        l.dots_y = 24;
+        l.dot_size = 4;
+        l.dot_spacing = 7;
+    } else if constexpr (Width == 72 && Height == 40) {
+        l.name_scale = 1;
+        l.line_y1 = 7;
+        l.name_y = 11;
+        l.line_y2 = 21;
+        l.dots_y = 26;
+        l.dot_size = 6;
+        l.dot_spacing = 10;
+    }
+    return l;
+}
+
+template <int Width, int Height, typename Bus>
+struct Ssd1306 {
+    static_assert(ssd1306_supported<Width, Height>(), "Unsupported panel size (128x64, 128x32 or 72x40)");
+
+    static constexpr int16_t width = Width;
+    static constexpr int16_t height = Height;
+    static constexpr int16_t page_count = Height / 8;
+    static constexpr uint16_t buffer_size = Width * Height / 8;
+    static constexpr ssd1306_wiring_t wiring = ssd1306_wiring<Width, Height>();
+    static constexpr ssd1306_layout_t layout = ssd1306_layout<Width, Height>();
+
+    // Left edge of a centered name of `len` characters, and of a centered
+    // row of `turns` dots
+    static constexpr int16_t name_x(uint8_t len) {
+        return (Width - len * 6 * layout.name_scale) / 2;
+    }
+    static constexpr int16_t dots_x(uint8_t turns) {
+        return (Width - (turns * layout.dot_size + (turns - 1) * (layout.dot_spacing - layout.dot_size))) / 2;
+    }
+
+    // Panels showing the buffer. Every flush goes to all of them, so the
+    // one shadow below stands for each panel's GDDRAM.
+    Bus *panel[SSD1306_MAX_PANELS];
+    uint8_t panels;
+    uint8_t buffer[buffer_size];
+
+    // Clip rectangle (inclusive, x0 > x1 or y0 > y1 means empty)
+    int16_t clip_x0, clip_y0, clip_x1, clip_y1;
+
+    // Dirty column range per page (inclusive, x0 > x1 means clean)
+    uint8_t dirty_x0[page_count];
+    uint8_t dirty_x1[page_count];
+
+    // Copy of what the panel's GDDRAM currently holds, used to trim
+    // the dirty window down to bytes that really changed
+    uint8_t shadow[buffer_size];
+    bool shadow_valid;
+
+    // Frame in flight for the asynchronous flush, staged as DATA_CMD
+    // words (ssd1306_bus.h): the window header, then the data with STOP on
+    // the last, so DMA can feed the bus while drawing continues in buffer
+    uint16_t tx_buffer[SSD1306_FLUSH_HEADER + buffer_size];
+
+    // Continuous hardware scroll is running (GDDRAM contents drift)
+    bool scrolling;
+
+    // Settings a re-init restores, and the panels due one (bit per panel)
+    // because a transfer to them failed (ssd1306_bus.h)
+    uint8_t contrast;
+    bool on;
+    uint8_t reinit;
+
+    struct cmd_list {
+        Ssd1306 *display;
+        uint8_t buf[SSD1306_CMD_LIST_MAX + 1];  // buf[0] is the bus framing byte
+        uint8_t len;
+        uint8_t panel;  // Index of the one panel to send to, or SSD1306_ALL_PANELS
+
+        void begin(Ssd1306 *target) {
+            display = target;
+            len = 1;  // buf[0] is left to the bus
+            panel = SSD1306_ALL_PANELS;
+        }
+
+        void send() {
+            if (len <= 1) return;
+            display->ready();  // Don't interleave with an async flush
+            for (uint8_t i = 0; i < display->panels; i++) {
+                if (panel != SSD1306_ALL_PANELS && panel != i) continue;
+                Bus *bus = display->panel[i];
+                bus->ops->write_cmds(bus, buf, len);
+            }
+            len = 1;
+        }
+
+        void append(const uint8_t *cmd, uint8_t count) {
+            // Commands are never split, so an overflowing list just goes
+            // out as two transactions
+            if (len + count > sizeof(buf)) {
+                send();
+            }
+            memcpy(buf + len, cmd, count);
+            len += count;
+        }
+
+        // Append one command with its argument bytes
+        template <typename... Bytes>
+        void push(Bytes... bytes) {
+            const uint8_t cmd[] = {(uint8_t)bytes...};
+            append(cmd, sizeof(cmd));
+        }
+    };
+
+    // Initialization and control. `bus` is an initialized backend
+    // (ssd1306_i2c.h, ssd1306_spi.h) for a panel of this size.
+    void init(Bus *bus) {
+        attach(bus);
+        configure(true);
+    }
+
+    // init() in two halves, so the first frame can be drawn while the
+    // panel is still powering up: attach sets up the buffer without
+    // touching the bus, configure sends the init sequence (one transaction
+    // per panel). With `on` false the panels stay dark, so the first frame
+    // can be sent before wake() lights them instead of showing stale GDDRAM.
+    void attach(Bus *bus) {
+        panel[0] = bus;
+        panels = 1;
+        reset_clip();
+
+        // Clear buffer; GDDRAM contents are unknown until the first full flush
+        memset(buffer, 0, buffer_size);
+        memset(dirty_x0, 0xFF, sizeof(dirty_x0));
+        memset(dirty_x1, 0, sizeof(dirty_x1));
+        invalidate();
+
+        scrolling = false;
+        contrast = SSD1306_DEFAULT_CONTRAST;
+        on = false;
+        reinit = 0;
+    }
+
+    void configure(bool turn_on) {
+        on = turn_on;
+        init_panel(SSD1306_ALL_PANELS, turn_on);
+    }
+
+    // Mirror the display onto another panel of the same type, between
+    // attach and configure: it is shown the same buffer as the others (one
+    // rasterization for all). Flushes to panels on different controllers
+    // run at the same time; a panel sharing a controller with an earlier
+    // one is sent its copy once that flush has ended.
+    void add_panel(Bus *bus) {
+        if (panels == SSD1306_MAX_PANELS) return;
+        panel[panels++] = bus;
+    }
+
+    // Flush and wait for it; a flush that fails is sent again whole, up to
+    // SSD1306_BUS_RETRIES times
+    void display() {
+        for (uint8_t attempt = 0; attempt <= SSD1306_BUS_RETRIES; attempt++) {
+            display_async();
+            wait();
+            if (shadow_valid) break;  // Not cut short
+        }
+    }
+
+    void display_async() {
+        // The bus and tx_buffer are owned by the previous flush until it ends
+        ready();
+
+        uint8_t x0, x1, p0, p1;
+        if (!take_window(&x0, &x1, &p0, &p1)) {
+            return;  // Panel already matches the buffer
+        }
+
+        uint16_t *data = stage_window(tx_buffer, x0, x1, p0, p1);
+        uint16_t *out = stage_data(data, buffer, x0, x1, p0, p1);
+        for (uint8_t page = p0; page <= p1; page++) {
+            uint16_t base = page * Width;
+            memcpy(shadow + base + x0, buffer + base + x0, x1 - x0 + 1);
+        }
+        shadow_valid = true;
+
+        flush_panels(tx_buffer, out - data);
+    }
+
+    // Show a complete flush transaction staged ahead of time, e.g. a frame
+    // pre-rendered into flash: SSD1306_FLUSH_HEADER words addressing the
+    // whole panel, then one DATA_CMD word per buffer byte with STOP on the
+    // last. Sent by DMA straight from `frame` (which must stay valid until
+    // the flush ends) unless only part of the panel differs.
+    void display_frame(const uint16_t *frame) {
+        ready();
+
+        // The buffer takes the frame's contents so later drawing and
+        // partial flushes carry on from what the panel shows
+        const uint16_t *data = frame + SSD1306_FLUSH_HEADER;
+        for (uint16_t i = 0; i < buffer_size; i++) {
+            buffer[i] = (uint8_t)data[i];
+        }
+        mark_dirty(0, Width - 1, 0, page_count - 1);
+
+        // Only part of the panel changed: a partial flush is cheaper on the
+        // bus than resending the whole frame
+        uint8_t x0, x1, p0, p1;
+        if (shadow_valid) {
+            if (!take_window(&x0, &x1, &p0, &p1)) {
+                return;
+            }
+            if (x0 != 0 || x1 != Width - 1 || p0 != 0 || p1 != page_count - 1) {
+                mark_dirty(x0, x1, p0, p1);
+                display_async();
+                return;
+            }
+        }
+
+        // Whole panel: the DMA reads the frame where it lies (flash, via XIP)
+        memcpy(shadow, buffer, buffer_size);
+        shadow_valid = true;
+        memset(dirty_x0, 0xFF, sizeof(dirty_x0));
+        memset(dirty_x1, 0, sizeof(dirty_x1));
+        flush_panels(frame, buffer_size);
+    }
+
+    // Does the panel hold exactly `frame` (same format as above)?
+    bool panel_matches(const uint16_t *frame) const {
+        if (!shadow_valid) return false;
+        const uint16_t *data = frame + SSD1306_FLUSH_HEADER;
+        for (uint16_t i = 0; i < buffer_size; i++) {
+            if (shadow[i] != (uint8_t)data[i]) return false;
+        }
+        return true;
+    }
+
+    // Flush a window whose contents are produced on the fly (e.g. decoded
+    // from a compressed asset) instead of coming from the buffer. Only
+    // SSD1306_STREAM_CHUNK words are staged at a time; DMA sends one chunk
+    // while the next is filled. The shadow follows what is sent, the buffer
+    // is left alone. Returns once the last chunk is queued (mirrors sharing
+    // a controller: once their copy from the shadow is).
+    void display_stream(uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1, ssd1306_stream_fill_t fill, void *ctx) {
+        ready();
+
+        // Two chunks of tx_buffer take turns: DMA sends one while the other
+        // is filled. The transaction stays open between chunks because the
+        // bus stalls (SCL held low, or SPI simply idles) while its TX FIFO
+        // is empty and the last word queued had no STOP.
+        uint16_t *chunks[2] = {tx_buffer, tx_buffer + SSD1306_STREAM_CHUNK};
+        uint8_t window_w = x1 - x0 + 1;
+        uint32_t remaining = (uint32_t)window_w * (p1 - p0 + 1);
+        uint8_t x = x0, page = p0;
+
+        uint16_t header[SSD1306_FLUSH_HEADER];
+        stage_window(header, x0, x1, p0, p1);
+
+        // Panels with a controller to themselves take the stream as it is
+        // produced; one sharing a controller can't start until that flush
+        // ends, so it is sent the window from the shadow afterwards
+        bool live[SSD1306_MAX_PANELS];
+        bool replay = false;
+        for (uint8_t i = 0; i < panels; i++) {
+            live[i] = panel_leads(i);
+            if (live[i]) {
+                panel[i]->ops->begin(panel[i], header, remaining);
+            } else {
+                replay = true;
+            }
+        }
+
+        for (uint8_t turn = 0;; turn ^= 1) {
+            uint16_t *chunk = chunks[turn];
+            uint16_t *out = chunk;
+            uint16_t n = remaining < SSD1306_STREAM_CHUNK ? remaining : SSD1306_STREAM_CHUNK;
+            uint16_t got = fill(ctx, out, n);
+            while (got < n) {
+                out[got++] = 0x00;  // Source ran short; keep the transaction whole
+            }
+
+            // Mirror what goes to GDDRAM so later partial flushes diff against it
+            for (uint16_t i = 0; i < n; i++) {
+                shadow[page * Width + x] = (uint8_t)out[i];
+                if (x++ == x1) {
+                    x = x0;
+                    page++;
+                }
+            }
+            out += n;
+            remaining -= n;
+            if (remaining == 0) {
+                out[-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+            }
+
+            // The previous chunk must be fully read before a channel takes
+            // the next one; an abort (NAK, or a bus stuck past the deadline)
+            // ends that panel's stream early
+            bool sent = false;
+            for (uint8_t i = 0; i < panels; i++) {
+                Bus *bus = panel[i];
+                if (!live[i]) continue;
+                while (bus->ops->sending(bus) && !ssd1306_bus_expired(bus)) {
+                    tight_loop_contents();
+                }
+                live[i] = bus->busy;
+                if (live[i]) {
+                    bus->ops->send(bus, chunk, n, remaining == 0);
+                    sent = true;
+                }
+            }
+            if (!sent || remaining == 0) {
+                break;
+            }
+        }
+
+        if (replay) {
+            // tx_buffer is free again once the stream is off the wire
+            wait();
+            uint16_t *data = stage_window(tx_buffer, x0, x1, p0, p1);
+            uint16_t *out = stage_data(data, shadow, x0, x1, p0, p1);
+            for (uint8_t i = 0; i < panels; i++) {
+                if (panel_leads(i)) continue;
+                Bus *bus = panel[i];
+                bus->ops->begin(bus, tx_buffer, out - data);
+                bus->ops->send(bus, data, out - data, true);
+            }
+        }
+    }
+
+    bool busy() {
+        bool in_flight = false;
+        for (uint8_t i = 0; i < panels; i++) {
+            Bus *bus = panel[i];
+            if (bus->busy && !ssd1306_bus_expired(bus)) {
+                in_flight = true;
+            } else if (bus->aborted) {
+                // A transfer failed: neither GDDRAM nor (if a glitch reset
+                // the panel) its settings can be trusted
+                bus->aborted = false;
+                reinit |= 1u << i;
+                invalidate();
+            }
+        }
+        return in_flight;
+    }
+
+    void wait() {
+        while (busy()) {
+            tight_loop_contents();
+        }
+    }
+
+    void clear() {
+        memset(buffer, 0, buffer_size);
+        mark_dirty(0, Width - 1, 0, page_count - 1);
+    }
+
+    void set_contrast(uint8_t level) {
+        contrast = level;
+        const uint8_t cmds[] = {SSD1306_SET_CONTRAST, level};
+        write_cmds(cmds, sizeof(cmds));
+    }
+
+    // Sleep mode: the panel goes dark and draws microamps, GDDRAM keeps the
+    // last frame. Waking sets `level` and turns it back on in a single
+    // transaction, showing that frame again without resending it.
+    void sleep() {
+        on = false;
+        write_cmd(SSD1306_DISPLAY_OFF);
+    }
+
+    void wake(uint8_t level) {
+        contrast = level;
+        on = true;
+        cmd_list list;
+        list.begin(this);
+        list.push(SSD1306_SET_CONTRAST, level);
+        list.push(SSD1306_DISPLAY_ON);
+        list.send();
+    }
+
+    void invert(bool inverted) {
+        write_cmd(inverted ? SSD1306_INVERT_DISPLAY : SSD1306_NORMAL_DISPLAY);
+    }
+
+    // Hardware scroll. Continuous scroll moves the whole page range every
+    // `interval` frames until stopped; content scroll (SSD1315 only, a
+    // plain SSD1306 ignores it) shifts columns x0..x1 by one (wrapping) and
+    // needs at least one panel frame between calls
+    void scroll_start(bool left, uint8_t page0, uint8_t page1, uint8_t interval) {
+        const uint8_t cmds[] = {
+            SSD1306_DEACTIVATE_SCROLL,
+            (uint8_t)(left ? SSD1306_LEFT_SCROLL : SSD1306_RIGHT_SCROLL),
+            0x00, page0, interval, page1, 0x00, 0xFF,
+            SSD1306_ACTIVATE_SCROLL,
+        };
+        write_cmds(cmds, sizeof(cmds));
+        scrolling = true;
+    }
+
+    void scroll_stop() {
+        write_cmd(SSD1306_DEACTIVATE_SCROLL);
+
+        // Continuous scroll leaves GDDRAM rotated by an unknown amount
+        if (scrolling) {
+            scrolling = false;
+            invalidate();
+        }
+    }
+
+    void scroll_content(bool left, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+        if (scrolling) {
+            scroll_stop();
+        }
+
+        const uint8_t cmds[] = {
+            (uint8_t)(left ? SSD1306_CONTENT_SCROLL_LEFT : SSD1306_CONTENT_SCROLL_RIGHT),
+            0x00, page0, 0x01, page1, 0x00,
+            (uint8_t)(x0 + wiring.column_offset), (uint8_t)(x1 + wiring.column_offset),
+        };
+        write_cmds(cmds, sizeof(cmds));
+
+        // Mirror the one-column rotation in the shadow so the next flush
+        // only sends the columns that differ from the shifted GDDRAM
+        for (uint8_t page = page0; page <= page1; page++) {
+            uint8_t *row = shadow + page * Width;
+            if (left) {
+                uint8_t wrapped = row[x0];
+                memmove(row + x0, row + x0 + 1, x1 - x0);
+                row[x1] = wrapped;
+            } else {
+                uint8_t wrapped = row[x1];
+                memmove(row + x0 + 1, row + x0, x1 - x0);
+                row[x0] = wrapped;
+            }
+        }
+    }
+
+    // Dirty-region tracking (drawing primitives mark automatically)
+    void mark_dirty(int16_t x0, int16_t x1, int16_t page0, int16_t page1) {
+        if (x0 < 0) x0 = 0;
+        if (x1 >= Width) x1 = Width - 1;
+        if (page0 < 0) page0 = 0;
+        if (page1 >= page_count) page1 = page_count - 1;
+
+        for (int16_t page = page0; page <= page1; page++) {
+            if (x0 < dirty_x0[page]) dirty_x0[page] = x0;
+            if (x1 > dirty_x1[page]) dirty_x1[page] = x1;
+        }
+    }
+
+    void invalidate() {
+        shadow_valid = false;
+        mark_dirty(0, Width - 1, 0, page_count - 1);
+    }
+
+    // Clip rectangle, kept inside the display: primitives, sprites and text
+    // are clipped to it up front, so whatever falls outside costs next to
+    // nothing. Attach sets the whole display, as does reset. Clearing and
+    // frames sent whole (display_frame()) ignore it.
+    void set_clip(int16_t x, int16_t y, int16_t w, int16_t h) {
+        clip_x0 = x < 0 ? 0 : x;
+        clip_y0 = y < 0 ? 0 : y;
+        clip_x1 = x + w > Width ? Width - 1 : x + w - 1;
+        clip_y1 = y + h > Height ? Height - 1 : y + h - 1;
+    }
+
+    void reset_clip() {
+        set_clip(0, 0, Width, Height);
+    }
+
+    // Drawing primitives
+    void draw_pixel(int16_t x, int16_t y, bool color) {
+        if (clipped_out(x, y, x, y)) {
+            return;
+        }
+        plot(x, y, color);
+
+        uint8_t page = y / 8;
+        if (x < dirty_x0[page]) dirty_x0[page] = x;
+        if (x > dirty_x1[page]) dirty_x1[page] = x;
+    }
+
+    void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h, bool color) {
+        // Clip once up front instead of per pixel
+        if (x < clip_x0) { w -= clip_x0 - x; x = clip_x0; }
+        if (y < clip_y0) { h -= clip_y0 - y; y = clip_y0; }
+        if (x + w > clip_x1 + 1) w = clip_x1 + 1 - x;
+        if (y + h > clip_y1 + 1) h = clip_y1 + 1 - y;
+        if (w <= 0 || h <= 0) return;
+
+        int16_t page0 = y / 8;
+        int16_t page1 = (y + h - 1) / 8;
+        mark_dirty(x, x + w - 1, page0, page1);
+
+        for (int16_t page = page0; page <= page1; page++) {
+            // Edge masks for the partial top and bottom pages
+            uint8_t mask = 0xFF;
+            if (page == page0) mask &= 0xFF << (y & 7);
+            if (page == page1) mask &= 0xFF >> (7 - ((y + h - 1) & 7));
+
+            uint8_t *row = buffer + page * Width + x;
+            if (mask == 0xFF) {
+                // Whole bytes; memset goes word-at-a-time on aligned runs
+                memset(row, color ? 0xFF : 0x00, w);
+            } else if (color) {
+                for (int16_t i = 0; i < w; i++) row[i] |= mask;
+            } else {
+                for (int16_t i = 0; i < w; i++) row[i] &= ~mask;
+            }
+        }
+    }
+
+    void draw_hline(int16_t x, int16_t y, int16_t w, bool color) {
+        fill_rect(x, y, w, 1, color);
+    }
+
+    void draw_vline(int16_t x, int16_t y, int16_t h, bool color) {
+        fill_rect(x, y, 1, h, color);
+    }
+
+    void draw_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, bool color) {
+        // Axis-aligned lines are just 1-pixel rects
+        if (y0 == y1) {
+            if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+            draw_hline(x0, y0, x1 - x0 + 1, color);
+            return;
+        }
+        if (x0 == x1) {
+            if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+            draw_vline(x0, y0, y1 - y0 + 1, color);
+            return;
+        }
+
+        // Cohen-Sutherland: both ends beyond the same edge of the clip
+        if (clipped_out(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0)) {
+            return;
+        }
+
+        // Step along the major axis a from a0 to a1; after k steps the minor
+        // axis b is at b0 + sb * f(k), f(k) = k * db / da rounded (halves up).
+        // That is exact in integers, so the clip cuts the run to steps k0..k1
+        // analytically and the pixels inside are the ones the whole line has.
+        bool steep = abs(y1 - y0) > abs(x1 - x0);
+        int16_t a0 = steep ? y0 : x0, a1 = steep ? y1 : x1;
+        int16_t b0 = steep ? x0 : y0, b1 = steep ? x1 : y1;
+        if (a0 > a1) {
+            int16_t t = a0; a0 = a1; a1 = t;
+            t = b0; b0 = b1; b1 = t;
+        }
+        int32_t da = a1 - a0;
+        int32_t db = abs(b1 - b0);
+        int16_t sb = b1 < b0 ? -1 : 1;
+        int16_t a_min = steep ? clip_y0 : clip_x0;
+        int16_t a_max = steep ? clip_y1 : clip_x1;
+        int16_t b_min = steep ? clip_x0 : clip_y0;
+        int16_t b_max = steep ? clip_x1 : clip_y1;
+
+        int32_t k0 = a_min > a0 ? a_min - a0 : 0;
+        int32_t k1 = a_max - a0 < da ? a_max - a0 : da;
+
+        // f(k) has to stay in lo..hi for b to be inside the clip (db > 0:
+        // axis-aligned lines went to fill_rect)
+        int32_t lo = sb > 0 ? b_min - b0 : b0 - b_max;
+        int32_t hi = sb > 0 ? b_max - b0 : b0 - b_min;
+        if (hi < 0) return;
+        if (lo > 0) {
+            int32_t first = (int32_t)(((int64_t)2 * lo * da - da + 2 * db - 1) / (2 * db));
+            if (first > k0) k0 = first;
+        }
+        int32_t last = (int32_t)(((int64_t)2 * hi * da + da - 1) / (2 * db));
+        if (last < k1) k1 = last;
+        if (k0 > k1) return;
+
+        int64_t num = (int64_t)2 * k0 * db + da;
+        int32_t f = (int32_t)(num / (2 * da));
+        int32_t rem = (int32_t)(num % (2 * da));
+        int16_t b_first = b0 + sb * f;
+        int16_t b_last = b0 + sb * (int32_t)(((int64_t)2 * k1 * db + da) / (2 * da));
+        int16_t b_lo = b_first < b_last ? b_first : b_last;
+        int16_t b_hi = b_first < b_last ? b_last : b_first;
+        if (steep) {
+            mark_dirty(b_lo, b_hi, (a0 + k0) / 8, (a0 + k1) / 8);
+        } else {
+            mark_dirty(a0 + k0, a0 + k1, b_lo / 8, b_hi / 8);
+        }
+
+        for (int32_t k = k0; k <= k1; k++) {
+            int16_t a = a0 + k;
+            int16_t b = b0 + sb * f;
+            if (steep) {
+                plot(b, a, color);
+            } else {
+                plot(a, b, color);
+            }
+            rem += 2 * db;
+            if (rem >= 2 * da) {
+                rem -= 2 * da;
+                f++;
+            }
+        }
+    }
+
+    void draw_rect(int16_t x, int16_t y, int16_t w, int16_t h, bool color) {
+        draw_hline(x, y, w, color);
+        draw_hline(x, y + h - 1, w, color);
+        draw_vline(x, y, h, color);
+        draw_vline(x + w - 1, y, h, color);
+    }
+
+    // Composite a sprite at any (x, y): each source page is shifted down by
+    // y & 7 and split across the two destination pages it straddles
+    void blit(const ssd1306_sprite_t *sprite, int16_t x, int16_t y, ssd1306_blit_mode_t mode) {
+        int16_t w = sprite->width;
+        int16_t pages = (sprite->height + 7) / 8;
+        int16_t first = x < clip_x0 ? clip_x0 - x : 0;
+        int16_t last = x + w > clip_x1 + 1 ? clip_x1 + 1 - x : w;
+        if (first >= last || pages == 0) return;
+
+        int16_t page_y = (y - (y & 7)) / 8;  // floor(y / 8), also for negative y
+        uint8_t shift = y & 7;
+        int16_t clip_p0 = clip_y0 / 8;
+        int16_t clip_p1 = clip_y1 / 8;
+
+        for (int16_t sp = 0; sp < pages; sp++) {
+            const uint8_t *src = sprite->data + sp * w;
+
+            // Upper part lands in page_y + sp, the spill-over in the next page
+            for (int16_t half = 0; half < 2; half++) {
+                int16_t dp = page_y + sp + half;
+                if (half && !shift) break;
+                if (dp < clip_p0 || dp > clip_p1) continue;
+
+                // Rows of this page inside the clip
+                uint8_t mask = 0xFF;
+                if (dp == clip_p0) mask &= 0xFF << (clip_y0 & 7);
+                if (dp == clip_p1) mask &= 0xFF >> (7 - (clip_y1 & 7));
+
+                uint8_t *row = buffer + dp * Width + x;
+                for (int16_t i = first; i < last; i++) {
+                    uint8_t bits = (half ? src[i] >> (8 - shift) : (uint8_t)(src[i] << shift)) & mask;
+                    switch (mode) {
+                        case SSD1306_BLIT_SET:   row[i] |= bits; break;
+                        case SSD1306_BLIT_CLEAR: row[i] &= ~bits; break;
+                        case SSD1306_BLIT_XOR:   row[i] ^= bits; break;
+                    }
+                }
+            }
+        }
+
+        mark_dirty(x + first, x + last - 1, page_y, page_y + pages - (shift ? 0 : 1));
+    }
+
+    // Copy a page-aligned region of the frame buffer into `data` so it can
+    // be blitted back later; the region must lie inside the display
+    void sprite_capture(ssd1306_sprite_t *sprite, uint8_t *data, int16_t x, int16_t page, int16_t w,
+                        int16_t pages) const {
+        for (int16_t p = 0; p < pages; p++) {
+            memcpy(data + p * w, buffer + (page + p) * Width + x, w);
+        }
+        sprite->data = data;
+        sprite->width = w;
+        sprite->height = pages * 8;
+    }
+
+    // Text rendering
+    void draw_char(int16_t x, int16_t y, char c, bool color) {
+        if (c < 32 || c > 126) {
+            c = '?';
+        }
+        if (clipped_out(x, y, x + 4, y + 6)) {
+            return;
+        }
+
+        const uint8_t *glyph = &font5x7[(c - 32) * 5];
+
+        for (int8_t i = 0; i < 5; i++) {
+            uint8_t line = glyph[i];
+            for (int8_t j = 0; j < 7; j++) {
+                if (line & (1 << j)) {
+                    draw_pixel(x + i, y + j, color);
+                }
+            }
+        }
+    }
+
+    void draw_string(int16_t x, int16_t y, const char *str, bool color) {
+        // Glyphs left of the clip are stepped over, the rest of the string
+        // once past its right edge
+        if (clipped_out(clip_x0, y, clip_x1, y + 6)) {
+            return;
+        }
+        while (*str && x <= clip_x1) {
+            if (x + 4 >= clip_x0) {
+                draw_char(x, y, *str, color);
+            }
+            x += 6;  // 5 pixel width + 1 pixel spacing
+            str++;
+        }
+    }
+
+    void draw_string_scaled(int16_t x, int16_t y, const char *str, uint8_t scale, bool color) {
+        if (clipped_out(clip_x0, y, clip_x1, y + 7 * scale - 1)) {
+            return;
+        }
+        while (*str && x <= clip_x1) {
+            if (x + 5 * scale > clip_x0) {
+                draw_char_scaled(x, y, *str, scale, color);
+            }
+            x += 6 * scale;  // (5 pixel width + 1 pixel spacing) * scale
+            str++;
+        }
+    }
+
+private:
+    // Does panel `i` have its controller to itself among the earlier panels?
+    bool panel_leads(uint8_t i) const {
+        for (uint8_t j = 0; j < i; j++) {
+            if (panel[j]->port == panel[i]->port) return false;
+        }
+        return true;
+    }
+
+    // Send a command sequence as one transaction
+    void write_cmds(const uint8_t *cmds, uint8_t len) {
+        cmd_list list;
+        list.begin(this);
+        list.append(cmds, len);
+        list.send();
+    }
+
+    void write_cmd(uint8_t cmd) {
+        write_cmds(&cmd, 1);
+    }
+
+    // Initialization sequence for SSD1306/SSD1315, one transaction to
+    // panel `target` (or SSD1306_ALL_PANELS)
+    void init_panel(uint8_t target, bool turn_on) {
+        cmd_list list;
+        list.begin(this);
+        list.panel = target;
+        list.push(SSD1306_DISPLAY_OFF);
+        list.push(SSD1306_SET_DISPLAY_CLOCK, 0x80);  // Default clock
+        list.push(SSD1306_SET_MULTIPLEX, Height - 1);
+        list.push(SSD1306_SET_DISPLAY_OFFSET, 0x00);
+        list.push(SSD1306_SET_START_LINE | 0x00);
+        list.push(SSD1306_CHARGE_PUMP, 0x14);        // Enable charge pump
+        list.push(SSD1306_MEMORY_MODE, 0x00);        // Horizontal addressing mode
+        list.push(SSD1306_SEG_REMAP | 0x01);         // Column 127 mapped to SEG0
+        list.push(SSD1306_COM_SCAN_DEC);             // Scan from COM[N-1] to COM0
+        list.push(SSD1306_SET_COM_PINS, wiring.com_pins);
+        list.push(SSD1306_SET_CONTRAST, contrast);
+        if constexpr (wiring.internal_iref) {
+            list.push(SSD1306_SET_IREF, 0x30);       // Internal reference current
+        }
+        list.push(SSD1306_SET_PRECHARGE, 0xF1);
+        list.push(SSD1306_SET_VCOM_DETECT, 0x40);
+        list.push(SSD1306_DISPLAY_ALL_ON_RESUME);
+        list.push(SSD1306_NORMAL_DISPLAY);
+        if (turn_on) {
+            list.push(SSD1306_DISPLAY_ON);
+        }
+        list.send();
+    }
+
+    // Wait for the panels, then send the init sequence again to any a
+    // transfer failed on, with the contrast and on/off state set since. The
+    // buffer is kept; the next flush resends all of it.
+    void ready() {
+        wait();
+        for (uint8_t i = 0; i < panels; i++) {
+            if (!(reinit & (1u << i))) continue;
+            reinit &= ~(1u << i);
+            perf_count_fault(PERF_FAULT_REINIT);
+            init_panel(i, on);
+        }
+    }
+
+    // Collect and reset the dirty state; returns false if the panel already
+    // matches the buffer
+    bool take_window(uint8_t *x0_out, uint8_t *x1_out, uint8_t *p0_out, uint8_t *p1_out) {
+        uint8_t win_x0 = 0xFF, win_x1 = 0;
+        int16_t win_p0 = -1, win_p1 = -1;
+
+        // Shrink each page's dirty range to the bytes that differ from
+        // GDDRAM, then take the bounding window over all pages that still
+        // need sending
+        for (uint8_t page = 0; page < page_count; page++) {
+            uint8_t x0 = dirty_x0[page];
+            uint8_t x1 = dirty_x1[page];
+            dirty_x0[page] = 0xFF;
+            dirty_x1[page] = 0;
+            if (x0 > x1) continue;
+
+            if (shadow_valid) {
+                const uint8_t *row = buffer + page * Width;
+                const uint8_t *old = shadow + page * Width;
+                while (x0 <= x1 && row[x0] == old[x0]) x0++;
+                if (x0 > x1) continue;
+                while (row[x1] == old[x1]) x1--;
+            }
+
+            if (x0 < win_x0) win_x0 = x0;
+            if (x1 > win_x1) win_x1 = x1;
+            if (win_p0 < 0) win_p0 = page;
+            win_p1 = page;
+        }
+
+        if (win_p0 < 0) {
+            return false;
+        }
+
+        *x0_out = win_x0;
+        *x1_out = win_x1;
+        *p0_out = win_p0;
+        *p1_out = win_p1;
+        return true;
+    }
+
+    // Stage the flush header: the address window goes in front of the data
+    // in the same transaction, each command byte behind its own Co=1
+    // control byte, then a Co=0 data control byte for the rest of the
+    // transfer
+    static uint16_t *stage_window(uint16_t *out, uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1) {
+        const uint8_t window[] = {
+            SSD1306_COLUMN_ADDR, (uint8_t)(x0 + wiring.column_offset), (uint8_t)(x1 + wiring.column_offset),
+            SSD1306_PAGE_ADDR, p0, p1,
+        };
+        for (uint8_t i = 0; i < sizeof(window); i++) {
+            *out++ = 0x80;  // Co=1, D/C#=0 (one command byte)
+            *out++ = window[i];
+        }
+        *out++ = 0x40;  // Co=0, D/C#=1 (data)
+        return out;
+    }
+
+    // Stage the window's bytes from `src` (buffer or shadow) row by row;
+    // the controller wraps to the next page at x1, so the whole window is
+    // one continuous data stream
+    static uint16_t *stage_data(uint16_t *out, const uint8_t *src, uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1) {
+        for (uint8_t page = p0; page <= p1; page++) {
+            const uint8_t *row = src + page * Width;
+            for (uint16_t x = x0; x <= x1; x++) {
+                *out++ = row[x];
+            }
+        }
+        out[-1] |= I2C_IC_DATA_CMD_STOP_BITS;
+        return out;
+    }
+
+    // Start a staged flush on every panel. DMA only reads the words, so all
+    // panels are fed from the same copy; those with a controller to
+    // themselves go first so they run side by side, then any sharing one,
+    // whose begin() waits for the controller.
+    void flush_panels(const uint16_t *flush, uint32_t count) {
+        for (uint8_t pass = 0; pass < 2; pass++) {
+            for (uint8_t i = 0; i < panels; i++) {
+                if (panel_leads(i) != (pass == 0)) continue;
+                Bus *bus = panel[i];
+                bus->ops->begin(bus, flush, count);
+                bus->ops->send(bus, flush + SSD1306_FLUSH_HEADER, count, true);
+            }
+        }
+    }
+
+    // Does the box from (x0, y0) to (x1, y1) (inclusive) miss the clip?
+    bool clipped_out(int16_t x0, int16_t y0, int16_t x1, int16_t y1) const {
+        return x1 < clip_x0 || x0 > clip_x1 || y1 < clip_y0 || y0 > clip_y1;
+    }
+
+    // Set or clear a pixel already known to be inside the clip; marking it
+    // dirty is left to the caller
+    void plot(int16_t x, int16_t y, bool color) {
+        if (color) {
+            buffer[x + (y / 8) * Width] |= (1 << (y & 7));
+        } else {
+            buffer[x + (y / 8) * Width] &= ~(1 << (y & 7));
+        }
+    }
+
+    void draw_char_scaled(int16_t x, int16_t y, char c, uint8_t scale, bool color) {
+        if (c < 32 || c > 126) {
+            c = '?';
+        }
+        if (clipped_out(x, y, x + 5 * scale - 1, y + 7 * scale - 1)) {
+            return;
+        }
+
+        // Common scales come pre-rendered from the generated atlas in flash
+        if (scale >= FONT_SCALED_MIN && scale <= FONT_SCALED_MAX) {
+            int16_t w = 5 * scale;
+            int16_t pages = (7 * scale + 7) / 8;
+            const ssd1306_sprite_t glyph = {
+                font_scaled_tables[scale - FONT_SCALED_MIN] + (c - 32) * w * pages,
+                w,
+                (int16_t)(7 * scale),
+            };
+            blit(&glyph, x, y, color ? SSD1306_BLIT_SET : SSD1306_BLIT_CLEAR);
+            return;
+        }
+
+        const uint8_t *glyph = &font5x7[(c - 32) * 5];
+
+        for (int8_t i = 0; i < 5; i++) {
+            uint8_t line = glyph[i];
+            for (int8_t j = 0; j < 7; j++) {
+                if (line & (1 << j)) {
+                    // Draw a filled rectangle for each pixel
+                    fill_rect(x + i * scale, y + j * scale, scale, scale, color);
+                }
+            }
+        }
+    }
+};
+
+#endif // SSD1306_HPP
@@ -0,0 +1,80 @@
+#ifndef SSD1306_BUS_H
+#define SSD1306_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hardware/i2c.h"
+
+// Transport between the SSD1306 driver and the panel (ssd1306_i2c.h,
+// ssd1306_spi.h). Data is staged as I2C DATA_CMD words whatever the bus:
+// the byte in the low 8 bits, I2C_IC_DATA_CMD_STOP_BITS on the last word.
+// That keeps frames pre-rendered into flash usable on any bus; SPI sends
+// the low byte and ignores the rest.
+//
+// A flush is begin() with the window header, then one or more send()s of
+// the data words. `busy` stays set from begin() until the last word has
+// left the wire. Commands go out blocking and never overlap a flush.
+// Several buses can share a controller (panels at 0x3C and 0x3D on one
+// I2C block); the backend makes each wait for the controller to be free.
+//
+// No transfer can hang the caller: each has a deadline of
+// ssd1306_bus_timeout_us(). A command transaction that fails is retried
+// up to SSD1306_BUS_RETRIES times; a flush past its deadline is ended
+// with abort(). Either way the backend frees the bus (on I2C by clocking
+// out whatever holds SDA low) and sets `aborted`, and the driver
+// re-initializes the panel before it next talks to it.
+typedef struct ssd1306_bus ssd1306_bus_t;
+
+#ifndef SSD1306_BUS_RETRIES
+#define SSD1306_BUS_RETRIES 2
+#endif
+
+// Slack on top of twice a transfer's time on the wire
+#ifndef SSD1306_BUS_TIMEOUT_MIN_US
+#define SSD1306_BUS_TIMEOUT_MIN_US 1000
+#endif
+
+// Flush header: six Co=1 command pairs for the column and page window plus
+// the data control byte (I2C framing; other buses take what they need)
+#define SSD1306_FLUSH_HEADER 13
+
+typedef struct {
+    // One blocking command transaction. buf[0] is free for the backend's
+    // framing byte; the commands are buf[1] to buf[len - 1].
+    void (*write_cmds)(ssd1306_bus_t *bus, uint8_t *buf, size_t len);
+    // Address the window staged in `header` (SSD1306_FLUSH_HEADER words)
+    // for `count` data words to follow. `header` is free on return.
+    void (*begin)(ssd1306_bus_t *bus, const uint16_t *header, uint32_t count);
+    // Queue `count` data words by DMA; `last` ends the flush. `words`
+    // belong to the bus until sending() goes false.
+    void (*send)(ssd1306_bus_t *bus, const uint16_t *words, uint32_t count, bool last);
+    bool (*sending)(ssd1306_bus_t *bus);
+    // End a flush that overran its deadline (a no-op if it has just
+    // ended), leaving the bus ready for the next transfer
+    void (*abort)(ssd1306_bus_t *bus);
+} ssd1306_bus_ops_t;
+
+struct ssd1306_bus {
+    const ssd1306_bus_ops_t *ops;
+    volatile bool busy;     // Flush in flight
+    volatile bool aborted;  // A transfer failed; the panel needs re-init and a full frame
+    const void *port;       // Controller instance; buses on the same one take turns
+    uint32_t baudrate;      // Wire speed, for the deadlines
+    uint32_t start_us;
+    uint32_t deadline_us;   // When the flush in flight counts as hung
+    int dma_chan;
+};
+
+// Bookkeeping every backend does when a flush starts and ends (the end
+// usually from its IRQ). `bytes` is the whole flush as it goes on the wire.
+static void ssd1306_bus_opened(ssd1306_bus_t *bus, uint32_t bytes);
+static void ssd1306_bus_closed(ssd1306_bus_t *bus, bool ok);
+
+// Deadline for a transfer of `bytes`: twice its time on the wire (9 clocks
+// a byte, for I2C's ACK) plus SSD1306_BUS_TIMEOUT_MIN_US
+static uint32_t ssd1306_bus_timeout_us(const ssd1306_bus_t *bus, uint32_t bytes);
+// Abort the flush in flight if it is past its deadline; true if it was
+static bool ssd1306_bus_expired(ssd1306_bus_t *bus);
+
+#endif // SSD1306_BUS_H
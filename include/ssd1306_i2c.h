@@ -0,0 +1,26 @@
+#ifndef SSD1306_I2C_H
+#define SSD1306_I2C_H
+
+#include "ssd1306_bus.h"
+#include "hardware/i2c.h"
+
+// I2C backend: every transfer is one transaction to `addr`. A flush is fed
+// to the controller's TX FIFO by DMA and ended by its STOP_DET IRQ (or a
+// NAK's TX_ABRT), so the IRQ goes to the core that calls init. Two panels
+// can share a controller at different addresses (0x3C, 0x3D); init both
+// before the first transfer.
+typedef struct {
+    ssd1306_bus_t bus;
+    i2c_inst_t *i2c;
+    uint8_t addr;
+    uint8_t sda_pin;
+    uint8_t scl_pin;
+} ssd1306_i2c_bus_t;
+
+// The controller must be set up already, at `baudrate` on these pins; a
+// stuck bus is freed by driving them as GPIOs, then the controller is
+// reset and set up again
+static void ssd1306_i2c_bus_init(ssd1306_i2c_bus_t *bus, i2c_inst_t *i2c, uint8_t addr,
+                                 uint8_t sda_pin, uint8_t scl_pin, uint32_t baudrate);
+
+#endif // SSD1306_I2C_H
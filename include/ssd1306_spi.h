@@ -0,0 +1,28 @@
+#ifndef SSD1306_SPI_H
+#define SSD1306_SPI_H
+
+#include "ssd1306_bus.h"
+#include "hardware/spi.h"
+
+// 4-wire SPI backend: D/C low for commands, high for data, CS held low for
+// a whole transaction. A flush sends the window commands blocking, then
+// DMA feeds the data to the TX FIFO; the DMA completion IRQ (DMA_IRQ_1)
+// waits out the last bytes and ends it. The IRQ goes to the core that
+// calls init. One panel per SPI controller.
+typedef struct {
+    ssd1306_bus_t bus;
+    spi_inst_t *spi;
+    uint8_t cs_pin;
+    uint8_t dc_pin;
+} ssd1306_spi_bus_t;
+
+// No reset line wired
+#define SSD1306_SPI_NO_RESET 0xFF
+
+// The controller and its SCK/MOSI pins must be set up already (8-bit
+// frames, mode 0, at most 10 MHz). CS, D/C and RES are driven as GPIOs;
+// the panel is reset here unless `reset_pin` is SSD1306_SPI_NO_RESET.
+static void ssd1306_spi_bus_init(ssd1306_spi_bus_t *bus, spi_inst_t *spi, uint8_t cs_pin, uint8_t dc_pin,
+                                 uint8_t reset_pin);
+
+#endif // SSD1306_SPI_H
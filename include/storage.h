@@ -0,0 +1,60 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hardware/flash.h"
+
+// Persistent state is an append-only log of fixed-size records spread over
+// STORAGE_SECTORS sectors at the end of flash. Records are programmed into
+// erased slots without touching their neighbours (NOR programming only
+// clears bits), so a sector is erased once per SAVE_RECORDS_PER_SECTOR
+// saves and erases rotate around the region.
+#ifndef STORAGE_SECTORS
+#define STORAGE_SECTORS 4
+#endif
+
+#define FLASH_TARGET_OFFSET (PICO_FLASH_SIZE_BYTES - STORAGE_SECTORS * FLASH_SECTOR_SIZE)
+#define SAVE_MAGIC 0x5455524E  // "TURN" in hex
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;       // Increments with every record, newest wins
+    uint8_t current;
+    uint8_t turns;
+    uint8_t padding[2];
+    uint32_t crc;       // CRC-32 of the fields above
+} save_record_t;
+
+#define SAVE_RECORD_SIZE sizeof(save_record_t)
+#define SAVE_RECORDS_PER_SECTOR (FLASH_SECTOR_SIZE / SAVE_RECORD_SIZE)
+#define SAVE_RECORDS_TOTAL (STORAGE_SECTORS * SAVE_RECORDS_PER_SECTOR)
+
+#ifndef SAVE_IDLE_MS
+#define SAVE_IDLE_MS 2000
+#endif
+
+// Program one flash page, erasing `erase_offset`'s sector first unless it
+// is STORAGE_NO_ERASE. Runs with the other core parked; false if the
+// lockout could not be taken or a DMA kept reading flash too long.
+#define STORAGE_NO_ERASE 0xFFFFFFFF
+static bool storage_program_page(uint32_t erase_offset, uint32_t page_offset, const uint8_t *page);
+static uint32_t storage_crc32(const uint8_t *data, size_t len);
+// Running form for data in pieces: start from 0xFFFFFFFF, invert the result
+static uint32_t storage_crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+static bool load_state(uint8_t *current, uint8_t *turns);
+static bool save_state(uint8_t current, uint8_t turns);
+
+// Write-behind persistence: persist_state() only records the change in RAM,
+// persist_poll() commits it once no change has arrived for SAVE_IDLE_MS, or
+// at its next call after persist_request_urgent() (e.g. before a watchdog
+// reboot). persist_flush() commits immediately.
+static void persist_state(uint8_t current, uint8_t turns);
+static void persist_request_urgent(void);
+static bool persist_pending(void);
+static void persist_flush(void);
+static void persist_poll(void);
+
+#endif // STORAGE_H
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Press-to-pixel tracing: timestamped events in a RAM ring per core (the
+// newest TRACE_RING_SIZE kept), dumped over USB by the `trace` console
+// command. tools/trace_decode.py turns a dump into a Chrome trace /
+// Perfetto timeline. With ENABLE_TRACE 0 every TRACE() compiles to nothing.
+#ifndef ENABLE_TRACE
+#define ENABLE_TRACE 0
+#endif
+
+// Events kept per core (power of two)
+#define TRACE_RING_SIZE 256
+
+// Names ending in _BEGIN/_END pair up into spans, the rest are instants.
+// tools/trace_decode.py takes the names from this enum: append only.
+typedef enum {
+    TRACE_GPIO_EDGE = 1,        // Button IRQ, bounces included (gpio | events << 8)
+    TRACE_BUTTON_ACCEPT,        // Debounced edge queued (button | pressed << 8)
+    TRACE_STATE,                // New state handed to the renderer (name | turns << 8)
+    TRACE_RENDER_BEGIN,         // Renderer picked up a command (type | name << 8)
+    TRACE_RENDER_END,
+    TRACE_FLUSH_BEGIN,          // One I2C transaction to the panel (words)
+    TRACE_FLUSH_END,
+    TRACE_SAVE_ERASE_BEGIN,     // Flash sector erase (state log or journal)
+    TRACE_SAVE_ERASE_END,
+    TRACE_SAVE_PROGRAM_BEGIN,   // Flash page program
+    TRACE_SAVE_PROGRAM_END,
+} trace_event_t;
+
+typedef struct {
+    uint32_t time_us;
+    uint8_t event;      // trace_event_t
+    uint8_t core;
+    uint16_t arg;
+} trace_record_t;
+
+// Dump framing, little-endian: TRACE_DUMP_MAGIC, version, record size,
+// core count, reserved byte, uint32 time of the dump; then per core a
+// uint32 record count and the records oldest first.
+#define TRACE_DUMP_MAGIC "TTTR"
+#define TRACE_DUMP_VERSION 1
+
+#if ENABLE_TRACE
+#define TRACE(event, arg) trace_record((event), (arg))
+// Safe from either core and from IRQs
+static void trace_record(trace_event_t event, uint16_t arg);
+#else
+#define TRACE(event, arg) ((void)0)
+#endif
+
+// Stream both rings over USB CDC in the dump framing; recording pauses
+// while it runs
+static void trace_dump(void);
+
+#endif // TRACE_H
@@ -0,0 +1,127 @@
+#include "anim.h"
+#include "perf.h"
+
+static void anim_decoder_init(anim_decoder_t *dec, const uint8_t *rle) {
+    dec->src = rle;
+    dec->run_left = 0;
+    dec->literal_left = 0;
+}
+
+static uint16_t anim_decode(void *ctx, uint16_t *out, uint16_t max) {
+    anim_decoder_t *dec = (anim_decoder_t *)ctx;
+    uint16_t n = 0;
+
+    while (n < max) {
+        if (dec->run_left) {
+            uint16_t count = dec->run_left < max - n ? dec->run_left : max - n;
+            dec->run_left -= count;
+            uint16_t word = dec->run_value;
+            while (count--) out[n++] = word;
+        } else if (dec->literal_left) {
+            uint16_t count = dec->literal_left < max - n ? dec->literal_left : max - n;
+            dec->literal_left -= count;
+            const uint8_t *src = dec->src;
+            while (count--) out[n++] = *src++;
+            dec->src = src;
+        } else {
+            uint8_t token = *dec->src++;
+            if (token & 0x80) {
+                dec->run_left = token - 0x80 + ANIM_RUN_MIN;
+                dec->run_value = *dec->src++;
+            } else {
+                dec->literal_left = token + 1;
+            }
+        }
+    }
+    return n;
+}
+
+static void anim_stream_frame(ssd1306_t *display, const uint8_t *frame) {
+    if (frame[2] == ANIM_NO_CHANGE) return;
+
+    anim_decoder_t dec;
+    anim_decoder_init(&dec, frame + 4);
+    ssd1306_display_stream(display, frame[0], frame[1], frame[2], frame[3], anim_decode, &dec);
+}
+
+static void anim_apply_frame(ssd1306_t *display, const uint8_t *frame) {
+    if (frame[2] == ANIM_NO_CHANGE) return;
+
+    uint8_t x0 = frame[0], x1 = frame[1], p0 = frame[2], p1 = frame[3];
+    anim_decoder_t dec;
+    anim_decoder_init(&dec, frame + 4);
+
+    uint16_t row[SSD1306_WIDTH];
+    for (uint8_t page = p0; page <= p1; page++) {
+        uint8_t *dst = display->buffer + page * SSD1306_WIDTH + x0;
+        uint16_t n = anim_decode(&dec, row, x1 - x0 + 1);
+        for (uint16_t i = 0; i < n; i++) {
+            dst[i] = (uint8_t)row[i];
+        }
+    }
+    ssd1306_mark_dirty(display, x0, x1, p0, p1);
+}
+
+static uint32_t anim_ease(anim_ease_t ease, uint32_t t) {
+    uint64_t u = t;
+    switch (ease) {
+        case ANIM_EASE_IN_OUT:
+            // 3t^2 - 2t^3
+            return (uint32_t)(u * u / ANIM_ONE * (3 * ANIM_ONE - 2 * u) / ANIM_ONE);
+        case ANIM_EASE_OUT: {
+            // 1 - (1 - t)^3
+            uint64_t r = ANIM_ONE - u;
+            return ANIM_ONE - (uint32_t)(r * r / ANIM_ONE * r / ANIM_ONE);
+        }
+        case ANIM_EASE_LINEAR:
+        default:
+            return t;
+    }
+}
+
+// Timer IRQ: flag the tick and wake the renderer core from WFE
+static bool anim_clock_tick(repeating_timer_t *rt) {
+    anim_clock_t *clock = (anim_clock_t *)rt->user_data;
+    clock->tick = true;
+    __sev();
+    return true;
+}
+
+static void anim_clock_start(anim_clock_t *clock, uint32_t duration_ms, uint32_t frame_ms, anim_ease_t ease) {
+    clock->start = get_absolute_time();
+    clock->duration_us = duration_ms * 1000;
+    clock->frame_us = frame_ms * 1000;
+    clock->ease = ease;
+    clock->tick = false;
+    clock->last_frame = 0;
+    // Negative delay: ticks are spaced from each tick's start, so they
+    // stay on the frame grid however long the callback is delayed
+    add_repeating_timer_us(-(int64_t)clock->frame_us, anim_clock_tick, clock, &clock->timer);
+}
+
+static void anim_clock_stop(anim_clock_t *clock) {
+    cancel_repeating_timer(&clock->timer);
+    clock->tick = false;
+}
+
+static bool anim_clock_take_tick(anim_clock_t *clock) {
+    if (!clock->tick) return false;
+    clock->tick = false;
+    return true;
+}
+
+static absolute_time_t anim_clock_next_tick(const anim_clock_t *clock) {
+    uint64_t elapsed = absolute_time_diff_us(clock->start, get_absolute_time());
+    return delayed_by_us(clock->start, (elapsed / clock->frame_us + 1) * clock->frame_us);
+}
+
+static bool anim_clock_frame(anim_clock_t *clock, uint32_t *progress) {
+    uint64_t elapsed = absolute_time_diff_us(clock->start, get_absolute_time());
+    if (elapsed >= clock->duration_us) return false;
+
+    uint32_t frame = elapsed / clock->frame_us;
+    perf_count_frame(frame > clock->last_frame + 1 ? frame - clock->last_frame - 1 : 0);
+    clock->last_frame = frame;
+    *progress = anim_ease(clock->ease, (uint32_t)(elapsed * ANIM_ONE / clock->duration_us));
+    return true;
+}
@@ -0,0 +1,119 @@
+#include "buttons.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "trace.h"
+
+static const uint8_t button_pins[BUTTON_COUNT] = {BUTTON_PIN, DEFER_BUTTON_PIN};
+
+typedef struct {
+    bool pressed;       // Last reported state
+    bool locked;        // Inside the debounce window
+} button_state_t;
+
+static button_state_t button_state[BUTTON_COUNT];
+
+// Single-producer/single-consumer ring: written only from IRQ context
+// (GPIO and timer IRQs share a priority, so never preempt each other),
+// read only by the main loop
+static button_event_t button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t button_head = 0;
+static volatile uint8_t button_tail = 0;
+
+static void buttons_push(uint8_t button, bool pressed, uint32_t time_us) {
+    uint8_t head = button_head;
+    if ((uint8_t)(head - button_tail) == BUTTON_QUEUE_SIZE) {
+        return;  // Full; the main loop is far behind, drop the event
+    }
+    TRACE(TRACE_BUTTON_ACCEPT, button | pressed << 8);
+
+    button_event_t *event = &button_queue[head % BUTTON_QUEUE_SIZE];
+    event->button = button;
+    event->pressed = pressed;
+    event->time_us = time_us;
+
+    __dmb();  // Publish the event before the index
+    button_head = head + 1;
+}
+
+static bool buttons_event_pending(void) {
+    return button_head != button_tail;
+}
+
+static bool buttons_poll(button_event_t *event) {
+    uint8_t tail = button_tail;
+    if (tail == button_head) {
+        return false;
+    }
+
+    __dmb();
+    *event = button_queue[tail % BUTTON_QUEUE_SIZE];
+    __dmb();
+    button_tail = tail + 1;
+    return true;
+}
+
+static int64_t buttons_debounce_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    uint8_t button = (uint8_t)(uintptr_t)user_data;
+    button_state_t *state = &button_state[button];
+
+    // The pin may have moved on while locked out (e.g. a short tap that
+    // released within the window); report where it settled
+    bool pressed = !gpio_get(button_pins[button]);
+    if (pressed != state->pressed) {
+        state->pressed = pressed;
+        buttons_push(button, pressed, time_us_32());
+    }
+
+    state->locked = false;
+    return 0;
+}
+
+static void buttons_gpio_irq(uint gpio, uint32_t events) {
+    uint32_t now = time_us_32();
+    TRACE(TRACE_GPIO_EDGE, gpio | events << 8);
+
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        if (button_pins[button] != gpio) continue;
+
+        button_state_t *state = &button_state[button];
+        if (state->locked) return;  // Bounce
+
+        // Buttons pull to ground, so a falling edge is a press. If both
+        // edges latched before we got here, it simply changed state.
+        bool pressed;
+        if ((events & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)) == (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)) {
+            pressed = !state->pressed;
+        } else {
+            pressed = (events & GPIO_IRQ_EDGE_FALL) != 0;
+        }
+        if (pressed == state->pressed) return;
+
+        state->pressed = pressed;
+        state->locked = true;
+        buttons_push(button, pressed, now);
+        if (add_alarm_in_ms(BUTTON_DEBOUNCE_MS, buttons_debounce_alarm, (void *)(uintptr_t)button, true) < 0) {
+            // No alarm to end the window: sample and unlock now rather than
+            // ignore the button for good
+            buttons_debounce_alarm(0, (void *)(uintptr_t)button);
+        }
+        return;
+    }
+}
+
+static void buttons_init(void) {
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        uint8_t pin = button_pins[button];
+
+        // Initialize buttons with internal pull-up
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_IN);
+        gpio_pull_up(pin);
+
+        button_state[button].pressed = !gpio_get(pin);
+        button_state[button].locked = false;
+
+        gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE,
+                                           true, buttons_gpio_irq);
+    }
+}
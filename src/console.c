@@ -0,0 +1,55 @@
+#include "console.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "journal.h"
+#include "trace.h"
+
+static void console_help(void);
+static void console_reboot(void);
+
+static const console_cmd_t console_cmds[] = {
+    {"stats", "dump performance counters", perf_print},
+    {"reset", "clear performance counters", perf_reset},
+    {"journal", "binary turn-history export (tools/journal_decode.py)", journal_export},
+    {"trace", "binary event trace dump (tools/trace_decode.py)", trace_dump},
+    {"reboot", "save pending state and restart", console_reboot},
+    {"help", "list commands", console_help},
+};
+
+static char console_line[CONSOLE_LINE_MAX];
+static uint8_t console_len = 0;
+
+static void console_help(void) {
+    for (size_t i = 0; i < count_of(console_cmds); i++) {
+        printf("%-8s %s\n", console_cmds[i].name, console_cmds[i].help);
+    }
+}
+
+static void console_reboot(void) {
+    console_reboot_requested = true;
+}
+
+static void console_run(const char *line) {
+    if (!*line) return;
+    for (size_t i = 0; i < count_of(console_cmds); i++) {
+        if (strcmp(line, console_cmds[i].name) == 0) {
+            console_cmds[i].run();
+            return;
+        }
+    }
+    printf("unknown command '%s' (try 'help')\n", line);
+}
+
+static void console_poll(void) {
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c == '\r' || c == '\n') {
+            console_line[console_len] = '\0';
+            console_run(console_line);
+            console_len = 0;
+        } else if (console_len < CONSOLE_LINE_MAX - 1) {
+            console_line[console_len++] = (char)c;
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#include "journal.h"
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdio_usb.h"
+
+#if JOURNAL_SECTORS < 2
+#error "JOURNAL_SECTORS must be at least 2 so a wrap keeps some history"
+#endif
+
+// Ring position, found by journal_scan() on first use
+static bool journal_scanned = false;
+static uint32_t journal_next_slot = 0;  // Slot the next record goes into
+static uint32_t journal_oldest = 0;     // Oldest record still in the ring
+static uint32_t journal_count = 0;      // Slots from journal_oldest up to journal_next_slot
+static uint32_t journal_seq = 0;        // Sequence number of the newest record
+static uint16_t journal_boot = 0;       // This boot's counter
+
+static journal_record_t journal_queue[JOURNAL_QUEUE_SIZE];
+static uint8_t journal_queued = 0;
+
+static const journal_record_t *journal_slot(uint32_t slot) {
+    return (const journal_record_t *)(XIP_BASE + JOURNAL_OFFSET + slot * JOURNAL_RECORD_SIZE);
+}
+
+static uint16_t journal_crc(const journal_record_t *rec) {
+    return (uint16_t)storage_crc32((const uint8_t *)rec, offsetof(journal_record_t, crc));
+}
+
+static bool journal_slot_valid(uint32_t slot) {
+    const journal_record_t *rec = journal_slot(slot);
+    return rec->seq != 0xFFFFFFFF && rec->crc == journal_crc(rec);
+}
+
+static bool journal_slot_blank(uint32_t slot) {
+    const uint32_t *words = (const uint32_t *)(XIP_BASE + JOURNAL_OFFSET + slot * JOURNAL_RECORD_SIZE);
+    for (size_t i = 0; i < JOURNAL_RECORD_SIZE / 4; i++) {
+        if (words[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+static void journal_scan(void) {
+    int32_t newest = -1, oldest = -1;
+    uint32_t oldest_seq = 0;
+    uint16_t last_boot = 0;
+
+    for (uint32_t slot = 0; slot < JOURNAL_RECORDS_TOTAL; slot++) {
+        if (!journal_slot_valid(slot)) continue;
+        const journal_record_t *rec = journal_slot(slot);
+        if (newest < 0 || (int32_t)(rec->seq - journal_seq) > 0) {
+            newest = slot;
+            journal_seq = rec->seq;
+            last_boot = rec->boot;
+        }
+        if (oldest < 0 || (int32_t)(rec->seq - oldest_seq) < 0) {
+            oldest = slot;
+            oldest_seq = rec->seq;
+        }
+    }
+
+    if (newest >= 0) {
+        // Append after the newest record, skipping anything half-written
+        journal_next_slot = newest + 1;
+        while (journal_next_slot % JOURNAL_RECORDS_PER_SECTOR != 0 &&
+               !journal_slot_blank(journal_next_slot)) {
+            journal_next_slot++;
+        }
+        journal_next_slot %= JOURNAL_RECORDS_TOTAL;
+        journal_oldest = oldest;
+        journal_count = (journal_next_slot + JOURNAL_RECORDS_TOTAL - journal_oldest) % JOURNAL_RECORDS_TOTAL;
+        if (journal_count == 0) journal_count = JOURNAL_RECORDS_TOTAL;
+        journal_boot = last_boot + 1;
+    } else {
+        journal_next_slot = 0;
+        journal_oldest = 0;
+        journal_count = 0;
+        journal_seq = 0;
+        journal_boot = 1;
+    }
+
+    journal_scanned = true;
+}
+
+static void journal_append(journal_event_t event, uint8_t name, uint8_t turns) {
+    // A full queue means flash was unavailable for a long time; keep the
+    // newest events
+    if (journal_queued == JOURNAL_QUEUE_SIZE) {
+        journal_flush();
+        if (journal_queued == JOURNAL_QUEUE_SIZE) {
+            memmove(journal_queue, journal_queue + 1, sizeof(journal_queue) - sizeof(journal_queue[0]));
+            journal_queued--;
+        }
+    }
+
+    // seq, boot and crc are filled in at commit time
+    journal_record_t *rec = &journal_queue[journal_queued++];
+    memset(rec, 0, sizeof(*rec));
+    rec->time_ms = to_ms_since_boot(get_absolute_time());
+    rec->event = event;
+    rec->name = name;
+    rec->turns = turns;
+}
+
+static void journal_poll(void) {
+    // Share the state log's idle window, so a burst of presses costs one
+    // program cycle; a full page goes out straight away
+    if (journal_queued && (journal_queued >= JOURNAL_RECORDS_PER_PAGE || !persist_pending())) {
+        journal_flush();
+    }
+}
+
+static void journal_flush(void) {
+    if (!journal_queued) return;
+    if (!journal_scanned) {
+        journal_scan();
+    }
+
+    // Each round programs the records that land in one page
+    uint8_t done = 0;
+    while (done < journal_queued) {
+        uint32_t slot = journal_next_slot;
+        uint32_t page_slot = slot - slot % JOURNAL_RECORDS_PER_PAGE;
+        uint8_t n = JOURNAL_RECORDS_PER_PAGE - (slot - page_slot);
+        if (n > journal_queued - done) n = journal_queued - done;
+
+        // Program a page of 0xFF around the records so the rest of the
+        // page is left untouched
+        uint8_t buffer[FLASH_PAGE_SIZE];
+        memset(buffer, 0xFF, sizeof(buffer));
+        uint32_t seq = journal_seq;
+        for (uint8_t i = 0; i < n; i++) {
+            journal_record_t rec = journal_queue[done + i];
+            rec.seq = ++seq;
+            rec.boot = journal_boot;
+            rec.crc = journal_crc(&rec);
+            memcpy(buffer + (slot - page_slot + i) * JOURNAL_RECORD_SIZE, &rec, sizeof(rec));
+        }
+
+        // Wrapping onto a sector drops the oldest records it still holds
+        bool erase = slot % JOURNAL_RECORDS_PER_SECTOR == 0 && !journal_slot_blank(slot);
+        uint32_t erase_offset = erase ? JOURNAL_OFFSET + (slot / JOURNAL_RECORDS_PER_SECTOR) * FLASH_SECTOR_SIZE
+                                      : STORAGE_NO_ERASE;
+        if (!storage_program_page(erase_offset, JOURNAL_OFFSET + page_slot * JOURNAL_RECORD_SIZE, buffer)) {
+            break;  // No flash access; keep the rest queued for the next commit
+        }
+
+        if (erase) {
+            uint32_t dropped = (journal_oldest == slot && journal_count) ? JOURNAL_RECORDS_PER_SECTOR : 0;
+            if (dropped) {
+                journal_oldest = (slot + JOURNAL_RECORDS_PER_SECTOR) % JOURNAL_RECORDS_TOTAL;
+                journal_count -= dropped;
+            }
+        }
+        journal_seq = seq;
+        journal_next_slot = (slot + n) % JOURNAL_RECORDS_TOTAL;
+        journal_count += n;
+        done += n;
+    }
+
+    memmove(journal_queue, journal_queue + done, (journal_queued - done) * sizeof(journal_queue[0]));
+    journal_queued -= done;
+}
+
+static void journal_put_u32(uint8_t *out, uint32_t v) {
+    out[0] = v;
+    out[1] = v >> 8;
+    out[2] = v >> 16;
+    out[3] = v >> 24;
+}
+
+// Add a run of consecutive records to the export CRC or, with `crc` NULL,
+// send it as it lies in XIP with no copying or formatting
+static void journal_export_span(uint32_t slot, uint32_t count, uint32_t *crc) {
+    const uint8_t *span = (const uint8_t *)journal_slot(slot);
+    if (crc) {
+        *crc = storage_crc32_update(*crc, span, count * JOURNAL_RECORD_SIZE);
+    } else {
+        stdio_usb.out_chars((const char *)span, count * JOURNAL_RECORD_SIZE);
+    }
+}
+
+// Walk the ring oldest first in runs of valid records. A run ends where
+// the region wraps or at a slot a power cut left half-written, which is
+// skipped. Each run goes to journal_export_span(); returns the record count.
+static uint32_t journal_export_records(uint32_t *crc) {
+    uint32_t count = 0;
+    uint32_t run_slot = 0, run_len = 0;
+    for (uint32_t i = 0; i < journal_count; i++) {
+        uint32_t slot = (journal_oldest + i) % JOURNAL_RECORDS_TOTAL;
+        bool valid = journal_slot_valid(slot);
+        if (run_len && (!valid || slot == 0)) {
+            journal_export_span(run_slot, run_len, crc);
+            run_len = 0;
+        }
+        if (!valid) continue;
+        if (!run_len) run_slot = slot;
+        run_len++;
+        count++;
+    }
+    if (run_len) journal_export_span(run_slot, run_len, crc);
+    return count;
+}
+
+static void journal_export(void) {
+    journal_flush();
+    if (!journal_scanned) {
+        journal_scan();
+    }
+
+    // One pass for the count and CRC, another to send the same records
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t count = journal_export_records(&crc);
+
+    uint8_t header[12];
+    memcpy(header, JOURNAL_EXPORT_MAGIC, 4);
+    header[4] = JOURNAL_EXPORT_VERSION;
+    header[5] = JOURNAL_RECORD_SIZE;
+    header[6] = 0;
+    header[7] = 0;
+    journal_put_u32(header + 8, count);
+    uint8_t trailer[4];
+    journal_put_u32(trailer, ~crc);
+
+    // Raw CDC writes: printf would translate any 0x0A byte into CR LF
+    stdio_flush();
+    stdio_usb.out_chars((const char *)header, sizeof(header));
+    journal_export_records(NULL);
+    stdio_usb.out_chars((const char *)trailer, sizeof(trailer));
+}
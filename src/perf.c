@@ -0,0 +1,100 @@
+#include "perf.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const perf_names[PERF_COUNT] = {
+    [PERF_BUS_WRITE] = "bus_write",
+    [PERF_RENDER] = "render",
+    [PERF_FLUSH] = "flush",
+    [PERF_SAVE_ERASE] = "save_erase",
+    [PERF_SAVE_PROGRAM] = "save_program",
+    [PERF_LOOP] = "loop",
+    [PERF_WAKE] = "wake",
+};
+
+static const char *const perf_fault_names[PERF_FAULT_COUNT] = {
+    [PERF_FAULT_NAK] = "nak",
+    [PERF_FAULT_TIMEOUT] = "timeout",
+    [PERF_FAULT_RETRY] = "retry",
+    [PERF_FAULT_RECOVERY] = "recovery",
+    [PERF_FAULT_REINIT] = "reinit",
+};
+
+static perf_stat_t perf_stats[PERF_COUNT];
+
+// Bytes on the wire to the panel (on I2C including each transaction's
+// address byte)
+static volatile uint32_t perf_bus_bytes;
+static volatile uint32_t perf_bus_transactions;
+
+// Reset until the first frame was on the panel (0 while booting); kept
+// across perf_reset()
+static volatile uint32_t perf_boot_us;
+
+// Animation frames, and frame ticks dropped because a flush overran
+static volatile uint32_t perf_anim_frames;
+static volatile uint32_t perf_anim_dropped;
+
+// Display bus failures, retries and recoveries
+static volatile uint32_t perf_faults[PERF_FAULT_COUNT];
+
+static void perf_record(perf_id_t id, uint32_t us) {
+    perf_stat_t *stat = &perf_stats[id];
+    if (stat->count == 0 || us < stat->min) stat->min = us;
+    if (us > stat->max) stat->max = us;
+    stat->total += us;
+    stat->count++;
+
+    uint8_t bin = us ? 32 - __builtin_clz(us) : 0;
+    if (bin >= PERF_HIST_BINS) bin = PERF_HIST_BINS - 1;
+    stat->hist[bin]++;
+}
+
+static void perf_count_bus(uint32_t bytes) {
+    perf_bus_bytes += bytes;
+    perf_bus_transactions++;
+}
+
+static void perf_count_frame(uint32_t dropped) {
+    perf_anim_frames++;
+    perf_anim_dropped += dropped;
+}
+
+static void perf_count_fault(perf_fault_t fault) {
+    perf_faults[fault]++;
+}
+
+static void perf_reset(void) {
+    memset(perf_stats, 0, sizeof(perf_stats));
+    perf_bus_bytes = 0;
+    perf_bus_transactions = 0;
+    perf_anim_frames = 0;
+    perf_anim_dropped = 0;
+    memset((void *)perf_faults, 0, sizeof(perf_faults));
+}
+
+static void perf_print(void) {
+    printf("boot: first frame %lu us after reset\n", (unsigned long)perf_boot_us);
+    printf("bus: %lu bytes in %lu transactions\n",
+           (unsigned long)perf_bus_bytes, (unsigned long)perf_bus_transactions);
+    printf("anim: %lu frames, %lu dropped\n",
+           (unsigned long)perf_anim_frames, (unsigned long)perf_anim_dropped);
+    printf("faults:");
+    for (int fault = 0; fault < PERF_FAULT_COUNT; fault++) {
+        printf(" %s %lu", perf_fault_names[fault], (unsigned long)perf_faults[fault]);
+    }
+    printf("\n");
+
+    printf("%-13s %8s %8s %8s %8s  histogram (us: <1 <2 <4 ... >=16384)\n",
+           "stat", "count", "min", "avg", "max");
+    for (int id = 0; id < PERF_COUNT; id++) {
+        const perf_stat_t *stat = &perf_stats[id];
+        uint32_t avg = stat->count ? (uint32_t)(stat->total / stat->count) : 0;
+        printf("%-13s %8lu %8lu %8lu %8lu ", perf_names[id], (unsigned long)stat->count,
+               (unsigned long)stat->min, (unsigned long)avg, (unsigned long)stat->max);
+        for (int bin = 0; bin < PERF_HIST_BINS; bin++) {
+            printf(" %lu", (unsigned long)stat->hist[bin]);
+        }
+        printf("\n");
+    }
+}
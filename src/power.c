@@ -0,0 +1,179 @@
+#include "power.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "pico/version.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/xosc.h"
+#include "renderer.h"
+
+static power_state_t power_state = POWER_ACTIVE;
+static absolute_time_t power_idle_since;
+static alarm_id_t power_alarm = 0;
+
+// Buttons whose press woke us; events from them are ignored until release
+static uint8_t power_swallow = 0;
+
+// Idle time at which each state is entered (0: never)
+static const uint32_t power_stage_ms[] = {
+    0,                 // POWER_ACTIVE
+    POWER_DIM_MS,      // POWER_DIMMED
+    POWER_OFF_MS,      // POWER_DISPLAY_OFF
+    POWER_DORMANT_MS,  // POWER_DORMANT
+};
+
+// Only here so a stage deadline wakes the sleeping main loop
+static int64_t power_wake_alarm(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+    power_alarm = 0;
+    return 0;
+}
+
+// Next state the idle policy steps down to, or POWER_ACTIVE if none
+static power_state_t power_next_state(void) {
+    for (int state = power_state + 1; state <= POWER_DORMANT; state++) {
+        if (power_stage_ms[state]) return (power_state_t)state;
+    }
+    return POWER_ACTIVE;
+}
+
+static void power_schedule(void) {
+    if (power_alarm > 0) {
+        cancel_alarm(power_alarm);
+        power_alarm = 0;
+    }
+    power_state_t next = power_next_state();
+    if (next != POWER_ACTIVE) {
+        absolute_time_t at = delayed_by_ms(power_idle_since, power_stage_ms[next]);
+        power_alarm = add_alarm_at(at, power_wake_alarm, NULL, true);
+    }
+}
+
+static void power_init(void) {
+    power_idle_since = get_absolute_time();
+    power_schedule();
+}
+
+// clk_peri follows clk_sys, so the bus dividers (and the deadlines that
+// come from the bus rate) have to follow too
+static void power_set_clock(uint32_t khz) {
+    set_sys_clock_khz(khz, true);
+    renderer_clock_changed();
+}
+
+// Back to full speed with the panel on; `since_us` is the wake edge
+static void power_wake(uint32_t since_us) {
+    if (power_state >= POWER_DISPLAY_OFF && POWER_SLOW_CLOCK_KHZ) {
+        power_set_clock(POWER_FULL_CLOCK_KHZ);
+    }
+    if (power_state != POWER_ACTIVE) {
+        renderer_set_power(RENDER_POWER_ON, since_us);
+    }
+    power_state = POWER_ACTIVE;
+    power_idle_since = get_absolute_time();
+    power_schedule();
+}
+
+static bool power_input(const button_event_t *event) {
+    bool was_off = power_state >= POWER_DISPLAY_OFF;
+    power_wake(event->time_us);
+
+    uint8_t bit = 1u << event->button;
+    if (was_off && event->pressed) {
+        power_swallow |= bit;
+    }
+    if (power_swallow & bit) {
+        if (!event->pressed) power_swallow &= ~bit;
+        return true;
+    }
+    return false;
+}
+
+// Stop every clock until BUTTON_PIN or DEFER_BUTTON_PIN is pulled low.
+// Runs from the crystal first, since dormant works by stopping it.
+static void power_dormant(void) {
+    static const uint8_t pins[] = {BUTTON_PIN, DEFER_BUTTON_PIN};
+
+    const uint32_t xosc_hz = XOSC_MHZ * MHZ;
+
+    clock_configure(clk_ref, CLOCKS_CLK_REF_CTRL_SRC_VALUE_XOSC_CLKSRC, 0, xosc_hz, xosc_hz);
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, xosc_hz, xosc_hz);
+    clock_stop(clk_usb);
+    clock_stop(clk_adc);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, xosc_hz, xosc_hz);
+    pll_deinit(pll_sys);
+    pll_deinit(pll_usb);
+
+    for (size_t i = 0; i < count_of(pins); i++) {
+        gpio_set_dormant_irq_enabled(pins[i], GPIO_IRQ_EDGE_FALL, true);
+    }
+    xosc_dormant();
+    for (size_t i = 0; i < count_of(pins); i++) {
+        gpio_set_dormant_irq_enabled(pins[i], GPIO_IRQ_EDGE_FALL, false);
+    }
+
+#if PICO_SDK_VERSION_MAJOR >= 2
+    runtime_init_clocks();
+#else
+    clocks_init();
+#endif
+
+    // The press that woke us may still be reported by the button IRQ
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        if (!gpio_get(pins[button])) power_swallow |= 1u << button;
+    }
+}
+
+static void power_poll(void) {
+    power_state_t next = power_next_state();
+    if (next == POWER_ACTIVE) return;
+    if (absolute_time_diff_us(power_idle_since, get_absolute_time()) < (int64_t)power_stage_ms[next] * 1000) {
+        return;
+    }
+
+    switch (next) {
+        case POWER_DIMMED:
+            renderer_set_power(RENDER_POWER_DIM, 0);
+            break;
+
+        case POWER_DISPLAY_OFF:
+            renderer_set_power(RENDER_POWER_OFF, 0);
+            if (POWER_SLOW_CLOCK_KHZ) {
+                // The renderer owns the bus until the panel is off
+                while (!renderer_power_settled()) {
+                    tight_loop_contents();
+                }
+                power_set_clock(POWER_SLOW_CLOCK_KHZ);
+            }
+            break;
+
+        case POWER_DORMANT:
+            // A USB host keeps us awake (and powered); look again later
+            if (stdio_usb_connected()) {
+                power_idle_since = get_absolute_time();
+                power_schedule();
+                return;
+            }
+
+            // Nothing may be left waiting on a timer that is about to stop
+            persist_flush();
+            journal_flush();
+            renderer_set_power(RENDER_POWER_OFF, 0);
+            while (!renderer_power_settled()) {
+                tight_loop_contents();
+            }
+            power_state = POWER_DORMANT;
+            power_dormant();
+            // The timer stood still while dormant, so the wake is timed
+            // from here (the crystal's startup is not counted)
+            power_wake(time_us_32());
+            return;
+
+        default:
+            return;
+    }
+
+    power_state = next;
+    power_schedule();
+}
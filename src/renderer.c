@@ -0,0 +1,539 @@
+#include "renderer.h"
+#if DISPLAY_BUS_SPI
+#include "ssd1306_spi.h"
+#else
+#include "ssd1306_i2c.h"
+#endif
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "perf.h"
+#include "trace.h"
+#include "state_frames.h"
+#include "anim_assets.h"
+
+#if (DISPLAY_STATE_FRAMES || DISPLAY_ANIM_ASSETS) && (STATE_FRAME_WIDTH != DISPLAY_WIDTH || STATE_FRAME_HEIGHT != DISPLAY_HEIGHT)
+#error "Pre-rendered frames were built for another display size"
+#endif
+
+static ssd1306_t display;
+#if DISPLAY_BUS_SPI
+static ssd1306_spi_bus_t display_bus;
+#else
+static ssd1306_i2c_bus_t display_bus;
+#endif
+#if DISPLAY_MIRROR
+static ssd1306_i2c_bus_t mirror_bus;
+#endif
+
+// Names to display
+static const char *names[] = {"Maia", "Adalie"};
+static const uint8_t num_names = 2;
+
+// UI constants
+#define BORDER_MARGIN 2
+#define LINE_MARGIN 8
+#define SLIDE_STEPS 12
+
+// Positions a slide moves through: the pre-built steps, or with the
+// controller scrolling, one column per panel frame
+#if DISPLAY_HW_SCROLL
+#define SLIDE_FRAMES DISPLAY_WIDTH
+#else
+#define SLIDE_FRAMES SLIDE_STEPS
+#endif
+
+// draw_content() layout for the panel size (ssd1306.hpp), fixed at build
+// time; only the centering depends on the name and turn count
+static constexpr ssd1306_layout_t layout = ssd1306_t::layout;
+static_assert(layout.line_y1 < layout.name_y && layout.name_y + 7 * layout.name_scale <= layout.line_y2 &&
+              layout.line_y2 < layout.dots_y &&
+              layout.dots_y + layout.dot_size <= DISPLAY_HEIGHT - BORDER_MARGIN - 1,
+              "draw_content() layout overlaps itself or the border");
+
+// Command queue from core 0 to the renderer. Lock-free single producer
+// (core 0) / single consumer (core 1); the producer rings SEV after each
+// push so an idle renderer sleeping in WFE picks it up.
+static volatile uint32_t render_queue[RENDER_QUEUE_SIZE];
+static volatile uint8_t render_head = 0;
+static volatile uint8_t render_tail = 0;
+
+// Command that didn't fit in the queue, retried by renderer_pump() (core 0)
+static uint32_t render_pending;
+static bool render_pending_valid = false;
+
+static bool render_try_push(uint32_t cmd) {
+    uint8_t head = render_head;
+    if ((uint8_t)(head - render_tail) == RENDER_QUEUE_SIZE) {
+        return false;
+    }
+    render_queue[head % RENDER_QUEUE_SIZE] = cmd;
+    __dmb();  // Publish the command before the index
+    render_head = head + 1;
+    __sev();
+    return true;
+}
+
+static void renderer_pump(void) {
+    if (render_pending_valid && render_try_push(render_pending)) {
+        render_pending_valid = false;
+    }
+}
+
+static void renderer_submit(uint32_t cmd) {
+    TRACE(TRACE_STATE, RENDER_CMD_NEW(cmd) | RENDER_CMD_TURNS(cmd) << 8);
+
+    // Keep order behind anything already waiting, and never block input:
+    // if the queue is full only the newest command is kept, which is all
+    // the renderer would end up drawing anyway
+    renderer_pump();
+    if (render_pending_valid || !render_try_push(cmd)) {
+        render_pending = cmd;
+        render_pending_valid = true;
+    }
+}
+
+// Panel power level asked for by core 0 and the one core 1 last applied
+static volatile uint8_t render_power_target = RENDER_POWER_ON;
+static volatile uint8_t render_power_applied = RENDER_POWER_ON;
+static volatile uint32_t render_wake_since;
+
+static void renderer_set_power(render_power_t level, uint32_t since_us) {
+    render_wake_since = since_us;
+    __dmb();
+    render_power_target = level;
+    __sev();
+}
+
+static bool renderer_power_settled(void) {
+    return render_power_applied == render_power_target;
+}
+
+static void renderer_clock_changed(void) {
+#if DISPLAY_BUS_SPI
+    display_bus.bus.baudrate = spi_set_baudrate(SPI_PORT, SPI_BAUDRATE);
+#else
+    display_bus.bus.baudrate = i2c_set_baudrate(I2C_PORT, I2C_BAUDRATE);
+#endif
+#if DISPLAY_MIRROR
+    mirror_bus.bus.baudrate = MIRROR_I2C_PORT == I2C_PORT ? display_bus.bus.baudrate
+                                                          : i2c_set_baudrate(MIRROR_I2C_PORT, I2C_BAUDRATE);
+#endif
+}
+
+static void renderer_show(uint8_t name_index, uint8_t turns) {
+    renderer_submit(RENDER_CMD(RENDER_SHOW, name_index, name_index, turns));
+}
+
+static void renderer_transition(uint8_t old_index, uint8_t new_index, uint8_t turns) {
+    renderer_submit(RENDER_CMD(RENDER_TRANSITION, old_index, new_index, turns));
+}
+
+// Core 1: newer commands waiting in the queue?
+static bool render_superseded(void) {
+    return render_head != render_tail;
+}
+
+// Core 1: drain the queue, keeping only the newest command
+static bool render_take_latest(uint32_t *cmd) {
+    uint8_t head = render_head;
+    if (head == render_tail) {
+        return false;
+    }
+    __dmb();
+    *cmd = render_queue[(uint8_t)(head - 1) % RENDER_QUEUE_SIZE];
+    __dmb();
+    render_tail = head;
+    return true;
+}
+
+// Core 1: a command taken during a slide that the slide didn't absorb,
+// drawn next unless something newer arrives first
+static uint32_t render_held;
+static bool render_held_valid = false;
+
+// Core 1: next command to draw
+static bool render_next(uint32_t *cmd) {
+    if (render_take_latest(cmd)) {
+        render_held_valid = false;
+        return true;
+    }
+    if (render_held_valid) {
+        *cmd = render_held;
+        render_held_valid = false;
+        return true;
+    }
+    return false;
+}
+
+// Core 1: a newer command arrived during the slide to `new_index`. A new
+// turn count for the incoming name retargets the slide (true, with
+// *turns updated); anything else cancels it and is drawn next.
+static bool render_retarget(uint8_t new_index, uint8_t *turns) {
+    uint32_t cmd;
+    if (!render_take_latest(&cmd)) return true;
+    if (RENDER_CMD_TYPE(cmd) == RENDER_SHOW && RENDER_CMD_NEW(cmd) == new_index) {
+        *turns = RENDER_CMD_TURNS(cmd);
+        return true;
+    }
+    render_held = cmd;
+    render_held_valid = true;
+    return false;
+}
+
+// Core 1: sleep until `clock` ticks, returning early (true) if a newer
+// command arrives. The timeout only guards against a missed SEV.
+static bool render_wait_tick(anim_clock_t *clock) {
+    while (!render_superseded()) {
+        if (anim_clock_take_tick(clock)) return false;
+        best_effort_wfe_or_timeout(anim_clock_next_tick(clock));
+    }
+    return true;
+}
+
+static uint8_t get_name_len(const char *name) {
+    uint8_t len = 0;
+    for (const char *p = name; *p; p++) len++;
+    return len;
+}
+
+// Draw screen content at a horizontal offset (for animation)
+static void draw_content(const char *name, uint8_t turns, int16_t x_offset, bool color) {
+    // Center name and dots horizontally with offset
+    int16_t name_x = ssd1306_t::name_x(get_name_len(name)) + x_offset;
+    int16_t dots_x = ssd1306_t::dots_x(turns) + x_offset;
+
+    // Draw name
+    ssd1306_draw_string_scaled(&display, name_x, layout.name_y, name, layout.name_scale, color);
+
+    // Draw horizontal lines
+    ssd1306_draw_line(&display, LINE_MARGIN + x_offset, layout.line_y1,
+                      DISPLAY_WIDTH - LINE_MARGIN + x_offset, layout.line_y1, color);
+    ssd1306_draw_line(&display, LINE_MARGIN + x_offset, layout.line_y2,
+                      DISPLAY_WIDTH - LINE_MARGIN + x_offset, layout.line_y2, color);
+
+    // Draw dots
+    for (uint8_t i = 0; i < turns; i++) {
+        int16_t x = dots_x + i * layout.dot_spacing;
+        ssd1306_fill_rect(&display, x, layout.dots_y, layout.dot_size, layout.dot_size, color);
+    }
+}
+
+// Rasterize a whole screen into the buffer
+static void render_screen(uint8_t name_index, uint8_t turns) {
+    uint32_t start = time_us_32();
+
+    // Fill white background
+    ssd1306_fill_rect(&display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, true);
+
+    // Draw black border
+    ssd1306_draw_rect(&display, BORDER_MARGIN, BORDER_MARGIN,
+                      DISPLAY_WIDTH - 2 * BORDER_MARGIN,
+                      DISPLAY_HEIGHT - 2 * BORDER_MARGIN, false);
+
+    // Draw content (black on white)
+    draw_content(names[name_index], turns, 0, false);
+    perf_record(PERF_RENDER, time_us_32() - start);
+}
+
+// Get a static screen ready to show: its frame pre-rendered into flash,
+// or NULL once it is rasterized into the buffer
+static const uint16_t *prepare_screen(uint8_t name_index, uint8_t turns) {
+#if DISPLAY_STATE_FRAMES
+    if (name_index < STATE_FRAME_NAMES && turns >= 1 && turns <= STATE_FRAME_TURNS) {
+        return state_frames[name_index][turns - 1];
+    }
+#endif
+    render_screen(name_index, turns);
+    return NULL;
+}
+
+static void show_screen(const uint16_t *frame) {
+    if (frame) {
+        // DMA sends the flash frame straight from XIP. The buffer takes a
+        // copy, so a flush that fails is resent from there.
+        ssd1306_display_frame(&display, frame);
+        ssd1306_wait(&display);
+        if (!display.shadow_valid) ssd1306_display(&display);
+    } else {
+        ssd1306_display(&display);
+    }
+}
+
+static void draw_screen(uint8_t name_index, uint8_t turns) {
+    show_screen(prepare_screen(name_index, turns));
+}
+
+// Off-screen copies of the two screens' content for the slide
+static uint8_t slide_pixels[2][SSD1306_BUFFER_SIZE];
+
+// Rasterize a screen's content once, as ink on a cleared buffer
+static void render_content_sprite(ssd1306_sprite_t *sprite, uint8_t *pixels,
+                                  const char *name, uint8_t turns) {
+    ssd1306_clear(&display);
+    draw_content(name, turns, 0, true);
+    ssd1306_sprite_capture(&display, sprite, pixels, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT / 8);
+}
+
+// Compose one slide frame: fixed border, old content `offset` columns out
+// to the left and the new content coming in from the right
+static void draw_slide_frame(const ssd1306_sprite_t *old_content, const ssd1306_sprite_t *new_content,
+                             int16_t offset) {
+    uint32_t start = time_us_32();
+
+    // Fill white background
+    ssd1306_fill_rect(&display, 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, true);
+
+#if DISPLAY_HW_SCROLL
+    // Only the inside of the border scrolls on the panel, so keep content
+    // from spilling over the margin
+    ssd1306_set_clip(&display, BORDER_MARGIN, 0, DISPLAY_WIDTH - 2 * BORDER_MARGIN, DISPLAY_HEIGHT);
+#endif
+
+    // Old content slides out to the left, new slides in from the right
+    ssd1306_blit(&display, old_content, -offset, 0, SSD1306_BLIT_CLEAR);
+    ssd1306_blit(&display, new_content, DISPLAY_WIDTH - offset, 0, SSD1306_BLIT_CLEAR);
+    ssd1306_reset_clip(&display);
+
+    // Draw black border (stays fixed)
+    ssd1306_draw_rect(&display, BORDER_MARGIN, BORDER_MARGIN,
+                      DISPLAY_WIDTH - 2 * BORDER_MARGIN,
+                      DISPLAY_HEIGHT - 2 * BORDER_MARGIN, false);
+    perf_record(PERF_RENDER, time_us_32() - start);
+}
+
+#if !DISPLAY_HW_SCROLL
+// Frame offsets of the pre-built slide, if there is one for this
+// transition and the panel shows the screen its first delta starts from
+static const uint32_t *slide_asset(uint8_t old_index, uint8_t new_index, uint8_t turns) {
+    if (old_index >= ANIM_SLIDE_NAMES || new_index >= ANIM_SLIDE_NAMES ||
+        old_index == new_index || turns != ANIM_SLIDE_TURNS) {
+        return NULL;
+    }
+    if (!ssd1306_panel_matches(&display, state_frames[old_index][0])) {
+        return NULL;
+    }
+    return anim_slide_index[old_index][new_index];
+}
+
+// Take the panel from slide step `from` to `to`. A single step streams its
+// delta straight onto the bus; after a jump the deltas in between are
+// folded into the buffer and go out as one partial flush. Streaming only
+// follows the panel in the shadow, so the buffer is brought up to step
+// `from` first: the flush sends each page's bounding window, including
+// bytes between the deltas that none of them touched.
+static void play_slide_steps(const uint32_t *frames, int16_t from, int16_t to) {
+    if (to == from + 1) {
+        anim_stream_frame(&display, anim_slide_data + frames[from]);
+        return;
+    }
+    memcpy(display.buffer, display.shadow, SSD1306_BUFFER_SIZE);
+    for (int16_t i = from; i < to; i++) {
+        anim_apply_frame(&display, anim_slide_data + frames[i]);
+    }
+    ssd1306_display_async(&display);
+}
+#endif
+
+static anim_clock_t slide_clock;
+
+static void animate_transition(uint8_t old_index, uint8_t new_index, uint8_t turns) {
+    const int16_t step_size = DISPLAY_WIDTH / SLIDE_FRAMES;
+
+    ssd1306_sprite_t old_content, new_content;
+
+#if DISPLAY_HW_SCROLL
+    render_content_sprite(&old_content, slide_pixels[0], names[old_index], 1);
+    render_content_sprite(&new_content, slide_pixels[1], names[new_index], turns);
+
+    // Bring the panel to the clipped starting frame, then let the controller
+    // shift GDDRAM a column per tick; each flush only carries the column
+    // that scrolled in. Ticks are a panel frame or more apart, and one that
+    // comes while the last flush is still going is dropped.
+    draw_slide_frame(&old_content, &new_content, 0);
+    ssd1306_display(&display);
+
+    int16_t step = 0;
+    anim_clock_start(&slide_clock, SLIDE_FRAMES * DISPLAY_SCROLL_COLUMN_MS, DISPLAY_SCROLL_COLUMN_MS,
+                     ANIM_EASE_LINEAR);
+    while (step < SLIDE_FRAMES) {
+        if (render_wait_tick(&slide_clock)) {
+            if (!render_retarget(new_index, &turns)) {
+                anim_clock_stop(&slide_clock);
+                return;
+            }
+            render_content_sprite(&new_content, slide_pixels[1], names[new_index], turns);
+            continue;
+        }
+        if (ssd1306_busy(&display)) continue;
+
+        uint32_t progress;
+        if (!anim_clock_frame(&slide_clock, &progress)) break;
+
+        ssd1306_scroll_content(&display, true, BORDER_MARGIN + 1,
+                               DISPLAY_WIDTH - BORDER_MARGIN - 2, 0, DISPLAY_HEIGHT / 8 - 1);
+        step++;
+        draw_slide_frame(&old_content, &new_content, step * step_size);
+        ssd1306_display_async(&display);
+    }
+    anim_clock_stop(&slide_clock);
+#else
+    const uint32_t *asset = NULL;
+#if DISPLAY_ANIM_ASSETS
+    asset = slide_asset(old_index, new_index, turns);
+#endif
+    if (!asset) {
+        render_content_sprite(&old_content, slide_pixels[0], names[old_index], 1);
+        render_content_sprite(&new_content, slide_pixels[1], names[new_index], turns);
+    }
+
+    // The slide moves in the fixed steps the assets are built with; each
+    // tick picks the step from the eased progress and draws it if the
+    // slide has moved on. Flushes go out over DMA while we wait.
+    int16_t step = 0;
+    anim_clock_start(&slide_clock, DISPLAY_SLIDE_MS, DISPLAY_FRAME_MS, DISPLAY_SLIDE_EASE);
+    while (true) {
+        if (render_wait_tick(&slide_clock)) {
+            if (!render_retarget(new_index, &turns)) {
+                anim_clock_stop(&slide_clock);
+                return;
+            }
+            // The incoming screen changed: carry on from the current step
+            // with it composited at runtime
+            if (asset) {
+                if (turns == ANIM_SLIDE_TURNS) continue;
+                render_content_sprite(&old_content, slide_pixels[0], names[old_index], 1);
+                asset = NULL;
+            }
+            render_content_sprite(&new_content, slide_pixels[1], names[new_index], turns);
+            continue;
+        }
+
+        // The last flush has overrun its frame: drop this tick
+        if (ssd1306_busy(&display)) continue;
+
+        uint32_t progress;
+        if (!anim_clock_frame(&slide_clock, &progress)) break;
+        int16_t target = progress * SLIDE_FRAMES / ANIM_ONE;
+        if (target == step) continue;
+
+        if (asset) {
+            play_slide_steps(asset, step, target);
+        } else {
+            draw_slide_frame(&old_content, &new_content, target * step_size);
+            ssd1306_display_async(&display);
+        }
+        step = target;
+    }
+    anim_clock_stop(&slide_clock);
+#endif
+
+    // Final frame - ensure perfectly centered
+    draw_screen(new_index, turns);
+}
+
+// Bring up the panel attached to `display`, on whichever bus config.h
+// selects, and its mirror. Drawing into the buffer may already have
+// started; `on` false leaves the panels dark.
+static void render_display_start(bool on) {
+    // Nothing reaches the panel before it has powered up. Counted from
+    // reset, so this is usually over by the time the first frame is ready.
+    sleep_until(from_us_since_boot(DISPLAY_POWER_UP_MS * 1000ull));
+
+#if DISPLAY_BUS_SPI
+    ssd1306_spi_bus_init(&display_bus, SPI_PORT, SPI_CS_PIN, SPI_DC_PIN, SPI_RESET_PIN);
+#else
+    ssd1306_i2c_bus_init(&display_bus, I2C_PORT, DISPLAY_I2C_ADDR, I2C_SDA_PIN, I2C_SCL_PIN, I2C_BAUDRATE);
+#endif
+#if DISPLAY_MIRROR
+    bool shared = MIRROR_I2C_PORT == I2C_PORT;
+    ssd1306_i2c_bus_init(&mirror_bus, MIRROR_I2C_PORT, MIRROR_I2C_ADDR, shared ? I2C_SDA_PIN : MIRROR_I2C_SDA_PIN,
+                         shared ? I2C_SCL_PIN : MIRROR_I2C_SCL_PIN, I2C_BAUDRATE);
+    ssd1306_add_panel(&display, &mirror_bus.bus);
+#endif
+    ssd1306_configure(&display, on);
+}
+
+static void render_display_init(void) {
+    ssd1306_attach(&display, &display_bus.bus);
+    render_display_start(true);
+}
+
+// Core 1: the first screen after reset. Core 0 queues the saved screen
+// before starting this core, so it is picked from flash (or rasterized)
+// while the panel powers up, sent right after the init sequence, and only
+// then lit. Clears the boot LED once it shows.
+static void render_boot(void) {
+    ssd1306_attach(&display, &display_bus.bus);
+
+    uint32_t cmd;
+    bool first = render_next(&cmd);
+    const uint16_t *frame = NULL;
+    if (first) {
+        TRACE(TRACE_RENDER_BEGIN, RENDER_CMD_TYPE(cmd) | RENDER_CMD_NEW(cmd) << 8);
+        frame = prepare_screen(RENDER_CMD_NEW(cmd), RENDER_CMD_TURNS(cmd));
+    }
+
+    render_display_start(!first);
+    if (first) {
+        show_screen(frame);
+        ssd1306_wake(&display, SSD1306_DEFAULT_CONTRAST);
+        perf_boot_us = time_us_32();
+        TRACE(TRACE_RENDER_END, 0);
+    }
+    gpio_put(LED_PIN, 0);
+}
+
+// Core 1: bring the panel to the power level core 0 asked for
+static void render_apply_power(void) {
+    uint8_t target = render_power_target;
+    uint8_t applied = render_power_applied;
+    if (target == applied) return;
+
+    if (target == RENDER_POWER_OFF) {
+        ssd1306_sleep(&display);
+    } else {
+        uint8_t contrast = target == RENDER_POWER_DIM ? POWER_DIM_CONTRAST : SSD1306_DEFAULT_CONTRAST;
+        if (applied == RENDER_POWER_OFF) {
+            // GDDRAM still holds the last frame: it is back as soon as the
+            // panel is on
+            ssd1306_wake(&display, contrast);
+            perf_record(PERF_WAKE, time_us_32() - render_wake_since);
+        } else {
+            ssd1306_set_contrast(&display, contrast);
+        }
+    }
+    render_power_applied = target;
+}
+
+static void renderer_core1_main(void) {
+    // Let flash_safe_execute() on core 0 park this core during flash writes
+    multicore_lockout_victim_init();
+
+    // The display's completion IRQ is registered on the core that inits it
+    render_boot();
+
+    while (true) {
+        render_apply_power();
+
+        uint32_t cmd;
+        if (!render_next(&cmd)) {
+            __wfe();
+            continue;
+        }
+
+        TRACE(TRACE_RENDER_BEGIN, RENDER_CMD_TYPE(cmd) | RENDER_CMD_NEW(cmd) << 8);
+        switch (RENDER_CMD_TYPE(cmd)) {
+            case RENDER_SHOW:
+                draw_screen(RENDER_CMD_NEW(cmd), RENDER_CMD_TURNS(cmd));
+                break;
+            case RENDER_TRANSITION:
+                animate_transition(RENDER_CMD_OLD(cmd), RENDER_CMD_NEW(cmd), RENDER_CMD_TURNS(cmd));
+                break;
+        }
+        TRACE(TRACE_RENDER_END, 0);
+    }
+}
+
+static void renderer_start(void) {
+    multicore_launch_core1(renderer_core1_main);
+}
@@ -0,0 +1,190 @@
+#include "ssd1306_i2c.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "perf.h"
+
+// Bus that last used each I2C controller (and gets its IRQ)
+static ssd1306_i2c_bus_t *ssd1306_i2c_irq_bus[2];
+
+// Take the controller, first letting a flush to another panel on it end
+static void ssd1306_i2c_claim(ssd1306_i2c_bus_t *bus) {
+    uint idx = i2c_hw_index(bus->i2c);
+    ssd1306_i2c_bus_t *owner = ssd1306_i2c_irq_bus[idx];
+    if (owner != bus) {
+        while (owner && owner->bus.busy && !ssd1306_bus_expired(&owner->bus)) {
+            tight_loop_contents();
+        }
+        ssd1306_i2c_irq_bus[idx] = bus;
+    }
+}
+
+// Free a bus a panel holds SDA low on (a glitch left it mid-byte): nine
+// SCL pulses from GPIO let it finish the byte whatever bit it was at, a
+// START and STOP reset its interface, then the controller is reset too.
+// Open drain by hand: a pin is only ever driven low or let go.
+static void ssd1306_i2c_recover(ssd1306_i2c_bus_t *bus) {
+    i2c_get_hw(bus->i2c)->enable = 0;
+    gpio_put(bus->sda_pin, 0);
+    gpio_put(bus->scl_pin, 0);
+    gpio_set_dir(bus->sda_pin, GPIO_IN);
+    gpio_set_dir(bus->scl_pin, GPIO_IN);
+    gpio_set_function(bus->sda_pin, GPIO_FUNC_SIO);
+    gpio_set_function(bus->scl_pin, GPIO_FUNC_SIO);
+
+    for (uint8_t i = 0; i < 9; i++) {
+        gpio_set_dir(bus->scl_pin, GPIO_OUT);
+        sleep_us(5);
+        gpio_set_dir(bus->scl_pin, GPIO_IN);
+        sleep_us(5);
+    }
+    gpio_set_dir(bus->sda_pin, GPIO_OUT);
+    sleep_us(5);
+    gpio_set_dir(bus->sda_pin, GPIO_IN);
+    sleep_us(5);
+
+    gpio_set_function(bus->sda_pin, GPIO_FUNC_I2C);
+    gpio_set_function(bus->scl_pin, GPIO_FUNC_I2C);
+    i2c_init(bus->i2c, bus->bus.baudrate);
+    perf_count_fault(PERF_FAULT_RECOVERY);
+}
+
+static void ssd1306_i2c_irq(uint idx) {
+    ssd1306_i2c_bus_t *bus = ssd1306_i2c_irq_bus[idx];
+    if (!bus) return;
+
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    uint32_t status = hw->intr_stat;
+    bool ok = true;
+
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        // Panel NAKed; the DMA is stalled on a flushed FIFO
+        (void)hw->clr_tx_abrt;
+        dma_channel_abort(bus->bus.dma_chan);
+        perf_count_fault(PERF_FAULT_NAK);
+        ok = false;
+    }
+    if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void)hw->clr_stop_det;
+    }
+
+    // Mask again so blocking writes keep polling STOP_DET themselves
+    hw->intr_mask = 0;
+    ssd1306_bus_closed(&bus->bus, ok);
+}
+
+static void ssd1306_i2c0_irq(void) { ssd1306_i2c_irq(0); }
+static void ssd1306_i2c1_irq(void) { ssd1306_i2c_irq(1); }
+
+static void ssd1306_i2c_write_cmds(ssd1306_bus_t *base, uint8_t *buf, size_t len) {
+    ssd1306_i2c_bus_t *bus = (ssd1306_i2c_bus_t *)base;
+    buf[0] = 0x00;  // Co=0, D/C#=0: every following byte is a command
+    ssd1306_i2c_claim(bus);
+
+    uint32_t start = time_us_32();
+    for (uint8_t attempt = 0;; attempt++) {
+        int ret = i2c_write_timeout_us(bus->i2c, bus->addr, buf, len, false,
+                                       ssd1306_bus_timeout_us(base, len + 1));
+        if (ret == (int)len) {
+            perf_count_bus(len + 1);
+            break;
+        }
+
+        // A timeout means the bus is stuck, and whatever wedged it may
+        // have reset the panel: it gets re-initialized even if a retry
+        // goes through
+        if (ret == PICO_ERROR_TIMEOUT) {
+            perf_count_fault(PERF_FAULT_TIMEOUT);
+            ssd1306_i2c_recover(bus);
+            base->aborted = true;
+        } else {
+            perf_count_fault(PERF_FAULT_NAK);
+        }
+        if (attempt == SSD1306_BUS_RETRIES) {
+            base->aborted = true;
+            break;
+        }
+        perf_count_fault(PERF_FAULT_RETRY);
+    }
+    perf_record(PERF_BUS_WRITE, time_us_32() - start);
+}
+
+static void ssd1306_i2c_begin(ssd1306_bus_t *base, const uint16_t *header, uint32_t count) {
+    ssd1306_i2c_bus_t *bus = (ssd1306_i2c_bus_t *)base;
+    ssd1306_i2c_claim(bus);
+
+    // Address the panel the same way i2c_write_timeout_us() does, then let
+    // STOP_DET (or an abort) tell us the last byte has left the wire
+    i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+    hw->enable = 0;
+    hw->tar = bus->addr;
+    hw->enable = 1;
+
+    (void)hw->clr_stop_det;
+    (void)hw->clr_tx_abrt;
+    ssd1306_bus_opened(base, 1 + SSD1306_FLUSH_HEADER + count);
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    // The header fits the 16-word TX FIFO, so the channel is free again
+    // almost at once; the controller holds SCL low until the data follows
+    dma_channel_transfer_from_buffer_now(base->dma_chan, header, SSD1306_FLUSH_HEADER);
+    while (dma_channel_is_busy(base->dma_chan)) {
+        tight_loop_contents();
+    }
+}
+
+static void ssd1306_i2c_send(ssd1306_bus_t *base, const uint16_t *words, uint32_t count, bool last) {
+    // The last word already carries STOP
+    (void)last;
+    dma_channel_transfer_from_buffer_now(base->dma_chan, words, count);
+}
+
+static bool ssd1306_i2c_sending(ssd1306_bus_t *base) {
+    return dma_channel_is_busy(base->dma_chan);
+}
+
+static void ssd1306_i2c_abort(ssd1306_bus_t *base) {
+    ssd1306_i2c_bus_t *bus = (ssd1306_i2c_bus_t *)base;
+    i2c_get_hw(bus->i2c)->intr_mask = 0;  // The IRQ can't end it as well
+    if (!base->busy) return;
+
+    dma_channel_abort(base->dma_chan);
+    ssd1306_i2c_recover(bus);
+    ssd1306_bus_closed(base, false);
+}
+
+static const ssd1306_bus_ops_t ssd1306_i2c_ops = {
+    .write_cmds = ssd1306_i2c_write_cmds,
+    .begin = ssd1306_i2c_begin,
+    .send = ssd1306_i2c_send,
+    .sending = ssd1306_i2c_sending,
+    .abort = ssd1306_i2c_abort,
+};
+
+static void ssd1306_i2c_bus_init(ssd1306_i2c_bus_t *bus, i2c_inst_t *i2c, uint8_t addr,
+                                 uint8_t sda_pin, uint8_t scl_pin, uint32_t baudrate) {
+    bus->bus.ops = &ssd1306_i2c_ops;
+    bus->bus.busy = false;
+    bus->bus.aborted = false;
+    bus->bus.port = i2c;
+    bus->bus.baudrate = baudrate;
+    bus->i2c = i2c;
+    bus->addr = addr;
+    bus->sda_pin = sda_pin;
+    bus->scl_pin = scl_pin;
+
+    // DMA words straight into DATA_CMD, paced by the TX FIFO
+    bus->bus.dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config cfg = dma_channel_get_default_config(bus->bus.dma_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, i2c_get_dreq(i2c, true));
+    dma_channel_configure(bus->bus.dma_chan, &cfg, &i2c_get_hw(i2c)->data_cmd, NULL, 0, false);
+
+    uint idx = i2c_hw_index(i2c);
+    i2c_get_hw(i2c)->intr_mask = 0;
+    ssd1306_i2c_irq_bus[idx] = bus;
+    irq_set_exclusive_handler(idx ? I2C1_IRQ : I2C0_IRQ, idx ? ssd1306_i2c1_irq : ssd1306_i2c0_irq);
+    irq_set_enabled(idx ? I2C1_IRQ : I2C0_IRQ, true);
+}
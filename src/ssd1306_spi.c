@@ -0,0 +1,130 @@
+#include "ssd1306_spi.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "perf.h"
+
+// Bus with a flush in flight, per SPI controller
+static ssd1306_spi_bus_t *ssd1306_spi_irq_bus[2];
+
+static void ssd1306_spi_dma_irq(void) {
+    for (uint idx = 0; idx < 2; idx++) {
+        ssd1306_spi_bus_t *bus = ssd1306_spi_irq_bus[idx];
+        if (!bus || !dma_channel_get_irq1_status(bus->bus.dma_chan)) continue;
+
+        dma_channel_acknowledge_irq1(bus->bus.dma_chan);
+        dma_channel_set_irq1_enabled(bus->bus.dma_chan, false);
+
+        // The DMA is done once the last bytes are in the FIFO; at most
+        // eight of them are still being shifted out
+        while (spi_is_busy(bus->spi)) {
+            tight_loop_contents();
+        }
+        gpio_put(bus->cs_pin, 1);
+        ssd1306_bus_closed(&bus->bus, true);
+    }
+}
+
+static void ssd1306_spi_write_cmds(ssd1306_bus_t *base, uint8_t *buf, size_t len) {
+    ssd1306_spi_bus_t *bus = (ssd1306_spi_bus_t *)base;
+
+    uint32_t start = time_us_32();
+    gpio_put(bus->cs_pin, 0);
+    gpio_put(bus->dc_pin, 0);
+    spi_write_blocking(bus->spi, buf + 1, len - 1);
+    gpio_put(bus->cs_pin, 1);
+    perf_record(PERF_BUS_WRITE, time_us_32() - start);
+    perf_count_bus(len - 1);
+}
+
+static void ssd1306_spi_begin(ssd1306_bus_t *base, const uint16_t *header, uint32_t count) {
+    ssd1306_spi_bus_t *bus = (ssd1306_spi_bus_t *)base;
+
+    // The header is six Co=1 command pairs and a data control byte; SPI
+    // only wants the commands
+    uint8_t window[SSD1306_FLUSH_HEADER / 2];
+    for (uint8_t i = 0; i < sizeof(window); i++) {
+        window[i] = (uint8_t)header[2 * i + 1];
+    }
+
+    ssd1306_bus_opened(base, sizeof(window) + count);
+    gpio_put(bus->cs_pin, 0);
+    gpio_put(bus->dc_pin, 0);
+    spi_write_blocking(bus->spi, window, sizeof(window));
+    gpio_put(bus->dc_pin, 1);
+}
+
+static void ssd1306_spi_send(ssd1306_bus_t *base, const uint16_t *words, uint32_t count, bool last) {
+    if (last) {
+        // Clear the previous chunk's completion before listening for this one
+        dma_channel_acknowledge_irq1(base->dma_chan);
+        dma_channel_set_irq1_enabled(base->dma_chan, true);
+    }
+    dma_channel_transfer_from_buffer_now(base->dma_chan, words, count);
+}
+
+static bool ssd1306_spi_sending(ssd1306_bus_t *base) {
+    return dma_channel_is_busy(base->dma_chan);
+}
+
+// SPI has no handshake to stall on, so this only fires if the DMA or its
+// IRQ went astray
+static void ssd1306_spi_abort(ssd1306_bus_t *base) {
+    ssd1306_spi_bus_t *bus = (ssd1306_spi_bus_t *)base;
+    dma_channel_set_irq1_enabled(base->dma_chan, false);
+    if (!base->busy) return;
+
+    dma_channel_abort(base->dma_chan);
+    gpio_put(bus->cs_pin, 1);
+    ssd1306_bus_closed(base, false);
+}
+
+static const ssd1306_bus_ops_t ssd1306_spi_ops = {
+    .write_cmds = ssd1306_spi_write_cmds,
+    .begin = ssd1306_spi_begin,
+    .send = ssd1306_spi_send,
+    .sending = ssd1306_spi_sending,
+    .abort = ssd1306_spi_abort,
+};
+
+static void ssd1306_spi_bus_init(ssd1306_spi_bus_t *bus, spi_inst_t *spi, uint8_t cs_pin, uint8_t dc_pin,
+                                 uint8_t reset_pin) {
+    bus->bus.ops = &ssd1306_spi_ops;
+    bus->bus.busy = false;
+    bus->bus.aborted = false;
+    bus->bus.port = spi;
+    bus->bus.baudrate = spi_get_baudrate(spi);
+    bus->spi = spi;
+    bus->cs_pin = cs_pin;
+    bus->dc_pin = dc_pin;
+
+    gpio_init(cs_pin);
+    gpio_put(cs_pin, 1);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    gpio_init(dc_pin);
+    gpio_set_dir(dc_pin, GPIO_OUT);
+
+    // RES# low for at least 3 us
+    if (reset_pin != SSD1306_SPI_NO_RESET) {
+        gpio_init(reset_pin);
+        gpio_set_dir(reset_pin, GPIO_OUT);
+        gpio_put(reset_pin, 0);
+        sleep_us(10);
+        gpio_put(reset_pin, 1);
+        sleep_us(10);
+    }
+
+    // 16-bit reads from the staged words into the 8-bit data register;
+    // the controller drops the upper bits
+    bus->bus.dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config cfg = dma_channel_get_default_config(bus->bus.dma_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, spi_get_dreq(spi, true));
+    dma_channel_configure(bus->bus.dma_chan, &cfg, &spi_get_hw(spi)->dr, NULL, 0, false);
+
+    ssd1306_spi_irq_bus[spi_get_index(spi)] = bus;
+    irq_set_exclusive_handler(DMA_IRQ_1, ssd1306_spi_dma_irq);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
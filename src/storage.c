@@ -0,0 +1,275 @@
+#include "storage.h"
+#include <stddef.h>
+#include <string.h>
+#include "pico/flash.h"
+#include "hardware/dma.h"
+#include "perf.h"
+#include "trace.h"
+
+// Layout written by older firmware: one record at the start of the last
+// sector, rewritten with an erase on every save
+typedef struct {
+    uint32_t magic;
+    uint8_t current;
+    uint8_t turns;
+    uint8_t padding[2];
+} legacy_save_data_t;
+
+#define LEGACY_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+#define STORAGE_LOCKOUT_TIMEOUT_MS 100
+// Longest a save waits for a DMA reading flash: a whole display frame on
+// a 400 kHz bus. A slower bus, or a stuck one (core 1 ends that flush at
+// its own deadline once it runs again), puts the save off instead.
+#define STORAGE_XIP_DMA_TIMEOUT_US 30000
+
+// Arguments for the flash operation run under flash_safe_execute()
+typedef struct {
+    uint32_t erase_offset;  // Sector to erase first, or STORAGE_NO_ERASE
+    uint32_t page_offset;
+    const uint8_t *page;
+    bool done;              // Set once the page is programmed
+} storage_flash_op_t;
+
+// Log position, found by the scan in load_state()
+static bool storage_scanned = false;
+static uint32_t storage_next_slot = 0;  // Slot the next record goes into
+static uint32_t storage_seq = 0;        // Sequence number of the newest record
+static bool storage_have_last = false;
+static uint8_t storage_last_current;
+static uint8_t storage_last_turns;
+
+static uint32_t storage_crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+static uint32_t storage_crc32(const uint8_t *data, size_t len) {
+    return ~storage_crc32_update(0xFFFFFFFF, data, len);
+}
+
+static const save_record_t *storage_slot(uint32_t slot) {
+    // Flash is memory-mapped, so we can read it directly
+    return (const save_record_t *)(XIP_BASE + FLASH_TARGET_OFFSET + slot * SAVE_RECORD_SIZE);
+}
+
+static bool storage_record_valid(const save_record_t *rec) {
+    return rec->magic == SAVE_MAGIC &&
+           rec->crc == storage_crc32((const uint8_t *)rec, offsetof(save_record_t, crc));
+}
+
+static bool storage_slot_blank(uint32_t slot) {
+    const uint32_t *words = (const uint32_t *)storage_slot(slot);
+    for (size_t i = 0; i < SAVE_RECORD_SIZE / 4; i++) {
+        if (words[i] != 0xFFFFFFFF) return false;
+    }
+    return true;
+}
+
+static void storage_scan(void) {
+    int32_t newest = -1;
+
+    for (uint32_t slot = 0; slot < SAVE_RECORDS_TOTAL; slot++) {
+        const save_record_t *rec = storage_slot(slot);
+        if (!storage_record_valid(rec)) continue;
+        if (newest < 0 || (int32_t)(rec->seq - storage_seq) > 0) {
+            newest = slot;
+            storage_seq = rec->seq;
+        }
+    }
+
+    if (newest >= 0) {
+        const save_record_t *rec = storage_slot(newest);
+        storage_have_last = true;
+        storage_last_current = rec->current;
+        storage_last_turns = rec->turns;
+
+        // Append after the newest record, skipping anything half-written
+        storage_next_slot = newest + 1;
+        while (storage_next_slot % SAVE_RECORDS_PER_SECTOR != 0 &&
+               !storage_slot_blank(storage_next_slot)) {
+            storage_next_slot++;
+        }
+        storage_next_slot %= SAVE_RECORDS_TOTAL;
+    } else {
+        storage_have_last = false;
+        storage_next_slot = 0;
+    }
+
+    storage_scanned = true;
+}
+
+static bool load_state(uint8_t *current, uint8_t *turns) {
+    storage_scan();
+
+    if (storage_have_last) {
+        *current = storage_last_current;
+        *turns = storage_last_turns;
+        return true;
+    }
+
+    // Fall back to the single record kept by older firmware
+    const legacy_save_data_t *legacy = (const legacy_save_data_t *)(XIP_BASE + LEGACY_OFFSET);
+    if (legacy->magic == SAVE_MAGIC) {
+        *current = legacy->current;
+        *turns = legacy->turns;
+        return true;
+    }
+    return false;
+}
+
+// A DMA still streaming from flash (a display frame served from XIP)
+// would read garbage once the flash leaves XIP mode. Called with the other
+// core parked and interrupts off, so no new transfer can start; false if
+// one is still reading flash after STORAGE_XIP_DMA_TIMEOUT_US.
+static bool storage_wait_xip_dma(void) {
+    uint32_t start = time_us_32();
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        while (dma_channel_is_busy(ch)) {
+            uintptr_t addr = dma_channel_hw_addr(ch)->read_addr;
+            if (addr < XIP_BASE || addr >= XIP_BASE + PICO_FLASH_SIZE_BYTES) break;
+            if (time_us_32() - start >= STORAGE_XIP_DMA_TIMEOUT_US) return false;
+            tight_loop_contents();
+        }
+    }
+    return true;
+}
+
+static void storage_flash_op(void *param) {
+    storage_flash_op_t *op = (storage_flash_op_t *)param;
+    if (!storage_wait_xip_dma()) return;
+    uint32_t start = time_us_32();
+    if (op->erase_offset != STORAGE_NO_ERASE) {
+        TRACE(TRACE_SAVE_ERASE_BEGIN, 0);
+        flash_range_erase(op->erase_offset, FLASH_SECTOR_SIZE);
+        uint32_t erased = time_us_32();
+        TRACE(TRACE_SAVE_ERASE_END, 0);
+        perf_record(PERF_SAVE_ERASE, erased - start);
+        start = erased;
+    }
+    TRACE(TRACE_SAVE_PROGRAM_BEGIN, 0);
+    flash_range_program(op->page_offset, op->page, FLASH_PAGE_SIZE);
+    TRACE(TRACE_SAVE_PROGRAM_END, 0);
+    perf_record(PERF_SAVE_PROGRAM, time_us_32() - start);
+    op->done = true;
+}
+
+static bool storage_program_page(uint32_t erase_offset, uint32_t page_offset, const uint8_t *page) {
+    storage_flash_op_t op = {
+        .erase_offset = erase_offset,
+        .page_offset = page_offset,
+        .page = page,
+        .done = false,
+    };
+
+    // XIP is unavailable while flash is busy: interrupts go off here and the
+    // other core (if running) is parked in RAM for the duration
+    return flash_safe_execute(storage_flash_op, &op, STORAGE_LOCKOUT_TIMEOUT_MS) == PICO_OK && op.done;
+}
+
+static bool save_state(uint8_t current, uint8_t turns) {
+    if (!storage_scanned) {
+        storage_scan();
+    }
+
+    // Nothing changed since the newest record, save the wear
+    if (storage_have_last && storage_last_current == current && storage_last_turns == turns) {
+        return true;
+    }
+
+    save_record_t rec = {0};
+    rec.magic = SAVE_MAGIC;
+    rec.seq = storage_seq + 1;
+    rec.current = current;
+    rec.turns = turns;
+    rec.crc = storage_crc32((const uint8_t *)&rec, offsetof(save_record_t, crc));
+
+    // Entering a sector: erase it if it still holds old records. Its
+    // contents are older than everything in the sector we just filled.
+    uint32_t slot = storage_next_slot;
+    bool erase = slot % SAVE_RECORDS_PER_SECTOR == 0 && !storage_slot_blank(slot);
+
+    // Program a whole page of 0xFF around the record; erased bits stay set,
+    // so neighbouring records in the page are left untouched
+    uint32_t offset = FLASH_TARGET_OFFSET + slot * SAVE_RECORD_SIZE;
+    uint32_t page_offset = offset & ~(FLASH_PAGE_SIZE - 1);
+    uint8_t buffer[FLASH_PAGE_SIZE];
+    memset(buffer, 0xFF, sizeof(buffer));
+    memcpy(buffer + (offset - page_offset), &rec, sizeof(rec));
+
+    uint32_t erase_offset = erase ? FLASH_TARGET_OFFSET + (slot / SAVE_RECORDS_PER_SECTOR) * FLASH_SECTOR_SIZE
+                                  : STORAGE_NO_ERASE;
+    if (!storage_program_page(erase_offset, page_offset, buffer)) {
+        return false;
+    }
+
+    storage_seq = rec.seq;
+    storage_have_last = true;
+    storage_last_current = current;
+    storage_last_turns = turns;
+    storage_next_slot = (slot + 1) % SAVE_RECORDS_TOTAL;
+    return true;
+}
+
+// Write-behind state, committed by persist_poll()
+static bool persist_dirty = false;
+static volatile bool persist_urgent = false;
+static uint8_t persist_current;
+static uint8_t persist_turns;
+static absolute_time_t persist_deadline;
+static alarm_id_t persist_alarm = 0;
+
+// Only here so the deadline wakes a sleeping main loop
+static int64_t persist_wake(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+    persist_alarm = 0;
+    return 0;
+}
+
+static void persist_state(uint8_t current, uint8_t turns) {
+    persist_current = current;
+    persist_turns = turns;
+    persist_dirty = true;
+
+    // Every change restarts the idle window, so a burst of presses
+    // becomes a single record
+    persist_deadline = make_timeout_time_ms(SAVE_IDLE_MS);
+
+    if (persist_alarm > 0) {
+        cancel_alarm(persist_alarm);
+    }
+    persist_alarm = add_alarm_at(persist_deadline, persist_wake, NULL, false);
+}
+
+static void persist_request_urgent(void) {
+    persist_urgent = true;
+}
+
+static bool persist_pending(void) {
+    return persist_dirty;
+}
+
+static void persist_flush(void) {
+    persist_urgent = false;
+    if (!persist_dirty) return;
+
+    if (save_state(persist_current, persist_turns)) {
+        persist_dirty = false;
+    } else {
+        // Couldn't get the flash; try again after another idle window
+        persist_state(persist_current, persist_turns);
+    }
+}
+
+static void persist_poll(void) {
+    if (!persist_dirty) return;
+    if (persist_urgent || time_reached(persist_deadline)) {
+        persist_flush();
+    }
+}
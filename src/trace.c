@@ -0,0 +1,82 @@
+#include "trace.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/sync.h"
+
+#define TRACE_CORES 2
+
+#if ENABLE_TRACE
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    uint32_t head;      // Total recorded; the oldest is overwritten
+} trace_ring_t;
+
+// One ring per core, so each only has to guard against its own IRQs
+static trace_ring_t trace_rings[TRACE_CORES];
+static volatile bool trace_paused = false;
+
+static void trace_record(trace_event_t event, uint16_t arg) {
+    if (trace_paused) return;
+
+    uint core = get_core_num();
+    trace_ring_t *ring = &trace_rings[core];
+    uint32_t ints = save_and_disable_interrupts();
+    trace_record_t *rec = &ring->records[ring->head++ % TRACE_RING_SIZE];
+    rec->time_us = time_us_32();
+    rec->event = event;
+    rec->core = core;
+    rec->arg = arg;
+    restore_interrupts(ints);
+}
+#endif
+
+static void trace_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void trace_dump(void) {
+    uint8_t header[12];
+    memcpy(header, TRACE_DUMP_MAGIC, 4);
+    header[4] = TRACE_DUMP_VERSION;
+    header[5] = sizeof(trace_record_t);
+    header[6] = TRACE_CORES;
+    header[7] = 0;
+    trace_put_u32(header + 8, time_us_32());
+
+    // Raw CDC writes: printf would translate any 0x0A byte into CR LF
+    stdio_flush();
+    stdio_usb.out_chars((const char *)header, sizeof(header));
+
+#if ENABLE_TRACE
+    trace_paused = true;
+    __dmb();
+    for (uint core = 0; core < TRACE_CORES; core++) {
+        // A record already under way on the other core finishes within a
+        // few instructions; the pause keeps new ones out
+        const trace_ring_t *ring = &trace_rings[core];
+        uint32_t head = ring->head;
+        uint32_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        uint32_t first = (head - count) % TRACE_RING_SIZE;
+        uint32_t len0 = count < TRACE_RING_SIZE - first ? count : TRACE_RING_SIZE - first;
+
+        uint8_t count_bytes[4];
+        trace_put_u32(count_bytes, count);
+        stdio_usb.out_chars((const char *)count_bytes, sizeof(count_bytes));
+        if (len0) {
+            stdio_usb.out_chars((const char *)&ring->records[first], len0 * sizeof(trace_record_t));
+        }
+        if (count > len0) {
+            stdio_usb.out_chars((const char *)ring->records, (count - len0) * sizeof(trace_record_t));
+        }
+    }
+    trace_paused = false;
+#else
+    // Built without tracing: an empty dump
+    static const uint8_t empty[4 * TRACE_CORES] = {0};
+    stdio_usb.out_chars((const char *)empty, sizeof(empty));
+#endif
+}
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""Pre-render and compress the slide transition between every pair of names.
+
+Usage: gen_anim_assets.py <font5x7.h> <ssd1306.hpp> <renderer.c> <config.h> <output.h> [WxH]
+
+WxH overrides the panel size in config.h, as for gen_state_frames.py.
+
+Frames are drawn like animate_transition() in src/renderer.c (without
+DISPLAY_HW_SCROLL) for a slide onto a screen with ANIM_SLIDE_TURNS turns.
+Each frame is a delta against the one before it (the first against the old
+name's 1-turn screen) and is stored as:
+
+    x0, x1, page0, page1   window covering every byte that changed
+                           (page0 = 0xFF: nothing changed)
+    RLE stream             the window's bytes, page by page, as tokens:
+                             0x00-0x7F  literal, (token + 1) bytes follow
+                             0x80-0xFF  run of (token - 0x80 + 3) copies
+                                        of the byte that follows
+
+anim_decode() in src/anim.c expands this straight into the I2C transmit
+path, so no frame is ever decompressed into RAM.
+"""
+import sys
+
+from gen_state_frames import Frame, draw_border, draw_content, draw_screen, load_ui
+
+SLIDE_TURNS = 1
+RUN_MIN = 3
+RUN_MAX = 0x7F + RUN_MIN
+LITERAL_MAX = 0x80
+NO_CHANGE = 0xFF
+
+
+def rle_encode(data):
+    out = []
+    literal = []
+
+    def flush_literal():
+        for i in range(0, len(literal), LITERAL_MAX):
+            chunk = literal[i:i + LITERAL_MAX]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+        del literal[:]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < RUN_MAX and data[i + run] == data[i]:
+            run += 1
+        if run >= RUN_MIN:
+            flush_literal()
+            out += [0x80 + run - RUN_MIN, data[i]]
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+    flush_literal()
+    return out
+
+
+def rle_decode(data):
+    out = []
+    i = 0
+    while i < len(data):
+        token = data[i]
+        if token < 0x80:
+            out.extend(data[i + 1:i + 2 + token])
+            i += 2 + token
+        else:
+            out.extend([data[i + 1]] * (token - 0x80 + RUN_MIN))
+            i += 2
+    return out
+
+
+def delta_window(prev, cur, width):
+    """Bounding window of changed bytes, as ssd1306_take_window() finds it."""
+    x0, x1, p0, p1 = width, -1, -1, -1
+    for page in range(len(cur) // width):
+        row = range(page * width, (page + 1) * width)
+        changed = [i - page * width for i in row if cur[i] != prev[i]]
+        if not changed:
+            continue
+        x0 = min(x0, changed[0])
+        x1 = max(x1, changed[-1])
+        if p0 < 0:
+            p0 = page
+        p1 = page
+    return (x0, x1, p0, p1) if p0 >= 0 else None
+
+
+def encode_frame(prev, cur, width):
+    window = delta_window(prev, cur, width)
+    if window is None:
+        return [0, 0, NO_CHANGE, 0]
+    x0, x1, p0, p1 = window
+    data = []
+    for page in range(p0, p1 + 1):
+        data.extend(cur[page * width + x0:page * width + x1 + 1])
+    encoded = [x0, x1, p0, p1] + rle_encode(data)
+    assert rle_decode(encoded[4:]) == data
+    return encoded
+
+
+def content_ink(name, turns, width, height, font, ui):
+    frame = Frame(width, height)
+    draw_content(frame, name, turns, 0, True, font, ui)
+    return frame.pixels
+
+
+def slide_frames(old, new, font, ui, width, height):
+    steps = ui["SLIDE_STEPS"]
+    step_size = width // steps
+    old_ink = content_ink(old, 1, width, height, font, ui)
+    new_ink = content_ink(new, SLIDE_TURNS, width, height, font, ui)
+
+    frames = []
+    for i in range(1, steps + 1):
+        offset = i * step_size
+        frame = Frame(width, height)
+        frame.fill_rect(0, 0, width, height, True)
+        for y in range(height):
+            for x in range(width):
+                sx = x + offset
+                if sx < width and old_ink[y][sx]:
+                    frame.pixels[y][x] = False
+                sx = x - (width - offset)
+                if 0 <= sx and new_ink[y][sx]:
+                    frame.pixels[y][x] = False
+        draw_border(frame, ui)
+        frames.append(frame.pages())
+    return frames
+
+
+def main():
+    if len(sys.argv) not in (6, 7):
+        sys.exit(__doc__)
+    font, names, ui, width, height = load_ui(*sys.argv[1:5], *sys.argv[6:])
+    steps = ui["SLIDE_STEPS"]
+
+    data = []
+    index = {}
+    raw_bytes = 0
+    for old in range(len(names)):
+        for new in range(len(names)):
+            if old == new:
+                continue
+            start = Frame(width, height)
+            draw_screen(start, names[old], 1, font, ui)
+            prev = start.pages()
+            offsets = []
+            for cur in slide_frames(names[old], names[new], font, ui, width, height):
+                offsets.append(len(data))
+                data += encode_frame(prev, cur, width)
+                prev = cur
+                raw_bytes += len(cur)
+            index[(old, new)] = offsets
+
+    lines = [
+        "// Generated by tools/gen_anim_assets.py - do not edit",
+        "#ifndef ANIM_ASSETS_H",
+        "#define ANIM_ASSETS_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define ANIM_SLIDE_NAMES %d" % len(names),
+        "#define ANIM_SLIDE_STEPS %d" % steps,
+        "#define ANIM_SLIDE_TURNS %d" % SLIDE_TURNS,
+        "#define ANIM_SLIDE_RAW_BYTES %d" % raw_bytes,
+        "",
+        "// Compressed slide frames (see src/anim.c), %d bytes for %d raw" % (len(data), raw_bytes),
+        "static const uint8_t anim_slide_data[%d] = {" % len(data),
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("// [old][new][step - 1]: offset of each frame in anim_slide_data (old == new unused)")
+    lines.append("static const uint32_t anim_slide_index[%d][%d][%d] = {"
+                 % (len(names), len(names), steps))
+    for old in range(len(names)):
+        lines.append("    {")
+        for new in range(len(names)):
+            offsets = index.get((old, new), [0] * steps)
+            lines.append("        {" + ", ".join("%d" % o for o in offsets) + "},")
+        lines.append("    },")
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif // ANIM_ASSETS_H")
+
+    with open(sys.argv[5], "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
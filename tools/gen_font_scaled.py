@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Generate pre-scaled font5x7 glyph tables in SSD1306 page format.
+
+Usage: gen_font_scaled.py <font5x7.h> <output.h>
+
+Each glyph at scale S is 5*S columns by 7*S rows, stored page-major:
+ceil(7*S / 8) pages of 5*S column bytes, bit 0 = top row of the page.
+"""
+import re
+import sys
+
+SCALES = (2, 3, 4)
+GLYPH_W = 5
+GLYPH_H = 7
+
+
+def load_font(path):
+    with open(path) as f:
+        src = f.read()
+    start = src.index("font5x7[]")
+    body = src[src.index("{", start):src.index("};", start)]
+    data = [int(h, 16) for h in re.findall(r"0x[0-9A-Fa-f]{2}", body)]
+    if len(data) % GLYPH_W:
+        sys.exit("font5x7: %d bytes is not a whole number of glyphs" % len(data))
+    return [data[i:i + GLYPH_W] for i in range(0, len(data), GLYPH_W)]
+
+
+def scale_glyph(glyph, scale):
+    width = GLYPH_W * scale
+    pages = (GLYPH_H * scale + 7) // 8
+    out = []
+    for page in range(pages):
+        for cx in range(width):
+            column = glyph[cx // scale]
+            byte = 0
+            for bit in range(8):
+                ry = page * 8 + bit
+                if ry < GLYPH_H * scale and column & (1 << (ry // scale)):
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    glyphs = load_font(sys.argv[1])
+
+    lines = [
+        "// Generated by tools/gen_font_scaled.py - do not edit",
+        "#ifndef FONT_SCALED_H",
+        "#define FONT_SCALED_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define FONT_SCALED_MIN %d" % min(SCALES),
+        "#define FONT_SCALED_MAX %d" % max(SCALES),
+        "#define FONT_SCALED_GLYPHS %d" % len(glyphs),
+        "",
+    ]
+    for scale in SCALES:
+        width = GLYPH_W * scale
+        pages = (GLYPH_H * scale + 7) // 8
+        lines.append("// Scale %d: %d columns x %d pages per glyph" % (scale, width, pages))
+        lines.append("static const uint8_t font5x7_x%d[%d][%d] = {"
+                     % (scale, len(glyphs), width * pages))
+        for i, glyph in enumerate(glyphs):
+            data = scale_glyph(glyph, scale)
+            lines.append("    {" + ", ".join("0x%02X" % b for b in data) + "},  // %d" % (32 + i))
+        lines.append("};")
+        lines.append("")
+
+    lines.append("// Indexed by scale - FONT_SCALED_MIN")
+    lines.append("static const uint8_t *const font_scaled_tables[] = {")
+    for scale in SCALES:
+        lines.append("    &font5x7_x%d[0][0]," % scale)
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif // FONT_SCALED_H")
+
+    with open(sys.argv[2], "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Pre-render every static UI screen as a ready-to-send flush transaction.
+
+Usage: gen_state_frames.py <font5x7.h> <ssd1306.hpp> <renderer.c> <config.h> <output.h> [WxH]
+
+WxH overrides the panel size in config.h (the host build tests every size).
+
+One frame per names[] entry and turn count 1-3, laid out exactly like
+draw_screen() in src/renderer.c (host/test_render checks that they agree).
+Each frame is a complete I2C transaction as DATA_CMD words, in the format
+ssd1306_display_frame() expects: column/page window commands covering the
+whole panel, the data control byte, then one word per GDDRAM byte with
+STOP on the last, so DMA can send it straight from flash.
+"""
+import re
+import sys
+
+from gen_font_scaled import GLYPH_H, GLYPH_W, load_font
+
+TURNS = (1, 2, 3)
+I2C_DATA_CMD_STOP = 0x200
+UI_DEFINES = ("BORDER_MARGIN", "LINE_MARGIN", "SLIDE_STEPS")
+LAYOUT_DEFINES = ("NAME_SCALE", "LINE_Y1", "NAME_Y", "LINE_Y2", "DOTS_Y", "DOT_SIZE", "DOT_SPACING")
+
+
+def parse_defines(src, path, names):
+    values = {}
+    for name in names:
+        m = re.search(r"#define\s+%s\s+(\w+)" % name, src)
+        if not m:
+            sys.exit("%s: no #define %s" % (path, name))
+        values[name] = int(m.group(1), 0)
+    return values
+
+
+def load_defines(path, names):
+    with open(path) as f:
+        return parse_defines(f.read(), path, names)
+
+
+def load_layout(path, width, height):
+    """The draw_content() layout for a width x height panel (ssd1306_layout())."""
+    with open(path) as f:
+        src = f.read()
+    start = src.find("ssd1306_layout()")
+    cond = r"if constexpr \(Width == %d && Height == %d\) \{" % (width, height)
+    m = re.compile(cond + r"(.*?)\}", re.S).search(src, max(start, 0))
+    if start < 0 or not m:
+        sys.exit("%s: no layout for %dx%d" % (path, width, height))
+    fields = dict(re.findall(r"l\.(\w+)\s*=\s*(\w+);", m.group(1)))
+    values = {}
+    for name in LAYOUT_DEFINES:
+        if name.lower() not in fields:
+            sys.exit("%s: %dx%d layout has no %s" % (path, width, height, name.lower()))
+        values[name] = int(fields[name.lower()], 0)
+    return values
+
+
+def load_names(path):
+    with open(path) as f:
+        src = f.read()
+    m = re.search(r"names\[\]\s*=\s*\{([^}]*)\}", src)
+    if not m:
+        sys.exit("%s: names[] not found" % path)
+    return re.findall(r'"((?:[^"\\]|\\.)*)"', m.group(1))
+
+
+def c_div(a, b):
+    # C integer division truncates toward zero
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+class Frame:
+    def __init__(self, width, height):
+        self.width = width
+        self.height = height
+        self.pixels = [[False] * width for _ in range(height)]
+
+    def fill_rect(self, x, y, w, h, color):
+        for yy in range(max(y, 0), min(y + h, self.height)):
+            for xx in range(max(x, 0), min(x + w, self.width)):
+                self.pixels[yy][xx] = color
+
+    def draw_rect(self, x, y, w, h, color):
+        self.fill_rect(x, y, w, 1, color)
+        self.fill_rect(x, y + h - 1, w, 1, color)
+        self.fill_rect(x, y, 1, h, color)
+        self.fill_rect(x + w - 1, y, 1, h, color)
+
+    def draw_string_scaled(self, x, y, text, font, scale, color):
+        for c in text:
+            code = ord(c)
+            if code < 32 or code > 126:
+                code = ord("?")
+            glyph = font[code - 32]
+            for i in range(GLYPH_W):
+                for j in range(GLYPH_H):
+                    if glyph[i] & (1 << j):
+                        self.fill_rect(x + i * scale, y + j * scale, scale, scale, color)
+            x += 6 * scale
+
+    def pages(self):
+        out = []
+        for page in range(self.height // 8):
+            for x in range(self.width):
+                byte = 0
+                for bit in range(8):
+                    if self.pixels[page * 8 + bit][x]:
+                        byte |= 1 << bit
+                out.append(byte)
+        return out
+
+
+def draw_content(frame, name, turns, x_offset, color, font, ui):
+    scale = ui["NAME_SCALE"]
+    dot_size = ui["DOT_SIZE"]
+    dot_spacing = ui["DOT_SPACING"]
+    text_width = len(name) * 6 * scale
+    dots_width = turns * dot_size + (turns - 1) * (dot_spacing - dot_size)
+
+    name_x = c_div(frame.width - text_width, 2) + x_offset
+    dots_x = c_div(frame.width - dots_width, 2) + x_offset
+
+    frame.draw_string_scaled(name_x, ui["NAME_Y"], name, font, scale, color)
+    for line_y in (ui["LINE_Y1"], ui["LINE_Y2"]):
+        x0 = ui["LINE_MARGIN"] + x_offset
+        x1 = frame.width - ui["LINE_MARGIN"] + x_offset
+        frame.fill_rect(x0, line_y, x1 - x0 + 1, 1, color)
+    for i in range(turns):
+        frame.fill_rect(dots_x + i * dot_spacing, ui["DOTS_Y"], dot_size, dot_size, color)
+
+
+def draw_border(frame, ui):
+    margin = ui["BORDER_MARGIN"]
+    frame.draw_rect(margin, margin, frame.width - 2 * margin, frame.height - 2 * margin, False)
+
+
+def draw_screen(frame, name, turns, font, ui):
+    frame.fill_rect(0, 0, frame.width, frame.height, True)
+    draw_border(frame, ui)
+    draw_content(frame, name, turns, 0, False, font, ui)
+
+
+def transaction(frame):
+    # Narrow panels show the middle of the controller's 128 columns
+    # (ssd1306_wiring() in include/ssd1306.hpp)
+    offset = (128 - frame.width) // 2
+    window = (0x21, offset, offset + frame.width - 1, 0x22, 0, frame.height // 8 - 1)
+    words = []
+    for cmd in window:
+        words += [0x80, cmd]  # Co=1, D/C#=0: one command byte
+    words.append(0x40)        # Co=0, D/C#=1: data follows
+    words += frame.pages()
+    words[-1] |= I2C_DATA_CMD_STOP
+    return words
+
+
+def load_ui(font_path, driver_path, renderer_path, config_path, size=None):
+    """Everything needed to redraw the UI: font, names, layout, geometry."""
+    font = load_font(font_path)
+    names = load_names(renderer_path)
+    if size:
+        m = re.fullmatch(r"(\d+)x(\d+)", size)
+        if not m:
+            sys.exit("bad panel size %r (want WxH)" % size)
+        width, height = int(m.group(1)), int(m.group(2))
+    else:
+        geometry = load_defines(config_path, ("DISPLAY_WIDTH", "DISPLAY_HEIGHT"))
+        width, height = geometry["DISPLAY_WIDTH"], geometry["DISPLAY_HEIGHT"]
+    ui = load_defines(renderer_path, UI_DEFINES)
+    ui.update(load_layout(driver_path, width, height))
+    return font, names, ui, width, height
+
+
+def main():
+    if len(sys.argv) not in (6, 7):
+        sys.exit(__doc__)
+    font, names, ui, width, height = load_ui(*sys.argv[1:5], *sys.argv[6:])
+    words = 13 + width * height // 8
+
+    lines = [
+        "// Generated by tools/gen_state_frames.py - do not edit",
+        "#ifndef STATE_FRAMES_H",
+        "#define STATE_FRAMES_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define STATE_FRAME_NAMES %d" % len(names),
+        "#define STATE_FRAME_TURNS %d" % len(TURNS),
+        "#define STATE_FRAME_WIDTH %d" % width,
+        "#define STATE_FRAME_HEIGHT %d" % height,
+        "#define STATE_FRAME_WORDS %d" % words,
+        "",
+        "// [name index][turns - 1], as I2C DATA_CMD words for ssd1306_display_frame()",
+        "static const uint16_t state_frames[%d][%d][%d] = {" % (len(names), len(TURNS), words),
+    ]
+    for name in names:
+        lines.append("    {")
+        for turns in TURNS:
+            frame = Frame(width, height)
+            draw_screen(frame, name, turns, font, ui)
+            data = transaction(frame)
+            lines.append("        {  // %s, %d turn(s)" % (name, turns))
+            for i in range(0, len(data), 16):
+                lines.append("            " + ", ".join("0x%03X" % w for w in data[i:i + 16]) + ",")
+            lines.append("        },")
+        lines.append("    },")
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif // STATE_FRAMES_H")
+
+    with open(sys.argv[5], "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
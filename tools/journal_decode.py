@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Pull the turn-history journal off the device and print it as CSV.
+
+Usage: journal_decode.py [--names src/renderer.c] <serial port | dump file>
+
+Given a serial port (e.g. /dev/ttyACM0), sends the console's `journal`
+command and reads the binary export; given a file, decodes a saved export
+(anything before the magic is skipped). The framing is described in
+include/journal.h: a 12-byte header, the packed 16-byte records oldest
+first, then the CRC-32 of the records. Slots whose own CRC fails (a write
+cut short by power loss) are skipped.
+"""
+import argparse
+import os
+import select
+import stat
+import struct
+import sys
+import zlib
+
+from gen_state_frames import load_names
+
+MAGIC = b"TTJL"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHI")
+RECORD = struct.Struct("<IIHBBBBH")
+EVENTS = {1: "boot", 2: "take", 3: "defer"}
+TIMEOUT_S = 2.0
+
+
+def read_port(path):
+    import termios
+    import tty
+
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    try:
+        tty.setraw(fd)
+        termios.tcflush(fd, termios.TCIOFLUSH)
+        os.write(fd, b"journal\r")
+
+        data = b""
+        need = None
+        while need is None or len(data) < need:
+            ready, _, _ = select.select([fd], [], [], TIMEOUT_S)
+            if not ready:
+                sys.exit("%s: timed out after %d bytes" % (path, len(data)))
+            data += os.read(fd, 65536)
+            start = data.find(MAGIC)
+            if need is None and start >= 0 and len(data) >= start + HEADER.size:
+                _, _, size, _, count = HEADER.unpack_from(data, start)
+                need = start + HEADER.size + count * size + 4
+        return data
+    finally:
+        os.close(fd)
+
+
+def decode(data):
+    start = data.find(MAGIC)
+    if start < 0:
+        sys.exit("no journal export found")
+    _, version, size, _, count = HEADER.unpack_from(data, start)
+    if version != VERSION or size != RECORD.size:
+        sys.exit("unsupported export: version %d, %d-byte records" % (version, size))
+
+    body = data[start + HEADER.size:start + HEADER.size + count * size]
+    trailer = data[start + HEADER.size + len(body):start + HEADER.size + len(body) + 4]
+    if len(trailer) != 4 or struct.unpack("<I", trailer)[0] != zlib.crc32(body):
+        sys.exit("export truncated or corrupt")
+
+    records = []
+    for off in range(0, len(body), size):
+        raw = body[off:off + size]
+        seq, time_ms, boot, event, name, turns, _, crc = RECORD.unpack(raw)
+        if crc != zlib.crc32(raw[:-2]) & 0xFFFF:
+            continue
+        records.append((seq, boot, time_ms, event, name, turns))
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("source", help="serial port or saved export")
+    parser.add_argument("--names", help="renderer.c to take names[] from")
+    args = parser.parse_args()
+
+    if stat.S_ISCHR(os.stat(args.source).st_mode):
+        data = read_port(args.source)
+    else:
+        with open(args.source, "rb") as f:
+            data = f.read()
+
+    names = load_names(args.names) if args.names else None
+
+    print("seq,boot,time_ms,event,name,turns")
+    for seq, boot, time_ms, event, name, turns in decode(data):
+        label = names[name] if names and name < len(names) else str(name)
+        print("%d,%d,%d,%s,%s,%d" % (seq, boot, time_ms, EVENTS.get(event, event), label, turns))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Turn a trace dump into a Chrome trace / Perfetto JSON timeline.
+
+Usage: trace_decode.py [--header include/trace.h] <serial port | dump file> > trace.json
+
+Given a serial port (e.g. /dev/ttyACM0), sends the console's `trace`
+command and reads the binary dump; given a file, decodes a saved dump
+(anything before the magic is skipped). The framing and event list are in
+include/trace.h. Open the output in chrome://tracing or ui.perfetto.dev.
+Press-to-pixel latency (accepted button edge to the end of the flush that
+showed the new state) is summarized on stderr.
+"""
+import argparse
+import json
+import os
+import re
+import select
+import stat
+import struct
+import sys
+
+MAGIC = b"TTTR"
+VERSION = 1
+HEADER = struct.Struct("<4sBBBxI")
+COUNT = struct.Struct("<I")
+RECORD = struct.Struct("<IBBH")
+TIMEOUT_S = 2.0
+DEFAULT_HEADER = os.path.join(os.path.dirname(__file__), "..", "include", "trace.h")
+
+# Panel transfers overlap the renderer's spans, so they get their own track
+TRACKS = {"FLUSH": "i2c"}
+
+
+def load_events(path):
+    """Event names by value, from the trace_event_t enum."""
+    with open(path) as f:
+        body = re.search(r"typedef enum \{(.*?)\} trace_event_t;", f.read(), re.S).group(1)
+    events = {}
+    value = 0
+    for name, explicit in re.findall(r"^\s*TRACE_(\w+)(?:\s*=\s*(\d+))?,", body, re.M):
+        value = int(explicit) if explicit else value + 1
+        events[value] = name
+    return events
+
+
+def read_port(path):
+    import termios
+    import tty
+
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    try:
+        tty.setraw(fd)
+        termios.tcflush(fd, termios.TCIOFLUSH)
+        os.write(fd, b"trace\r")
+
+        data = b""
+        while True:
+            ready, _, _ = select.select([fd], [], [], TIMEOUT_S)
+            if not ready:
+                sys.exit("%s: timed out after %d bytes" % (path, len(data)))
+            data += os.read(fd, 65536)
+            if split(data, partial=True) is not None:
+                return data
+    finally:
+        os.close(fd)
+
+
+def split(data, partial=False):
+    """(dump time, [records]) or None if the dump is still incomplete."""
+    start = data.find(MAGIC)
+    if start < 0 or len(data) < start + HEADER.size:
+        if partial:
+            return None
+        sys.exit("no trace dump found")
+    _, version, size, cores, now = HEADER.unpack_from(data, start)
+    if version != VERSION or size != RECORD.size:
+        sys.exit("unsupported dump: version %d, %d-byte records" % (version, size))
+
+    records = []
+    pos = start + HEADER.size
+    for _ in range(cores):
+        if len(data) < pos + COUNT.size:
+            return None if partial else sys.exit("dump truncated")
+        (count,) = COUNT.unpack_from(data, pos)
+        pos += COUNT.size
+        if len(data) < pos + count * size:
+            return None if partial else sys.exit("dump truncated")
+        records += [RECORD.unpack_from(data, pos + i * size) for i in range(count)]
+        pos += count * size
+    return now, records
+
+
+def decode(data, events):
+    now, records = split(data)
+    # time_us_32() wraps every ~71 minutes: place everything relative to
+    # the dump, which is newer than any record
+    timed = sorted(((now - t) & 0xFFFFFFFF, name, core, arg) for t, name, core, arg in records)
+    if not timed:
+        return [], []
+    oldest = timed[-1][0]
+    timed = [(oldest - age, events.get(event, str(event)), core, arg) for age, event, core, arg in reversed(timed)]
+
+    trace = [{"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "turn-taker"}}]
+    tids = {}
+
+    def tid(track):
+        if track not in tids:
+            tids[track] = len(tids)
+            trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tids[track],
+                          "args": {"name": track}})
+        return tids[track]
+
+    for ts, name, core, arg in timed:
+        base, phase = name, "i"
+        for suffix, ph in (("_BEGIN", "B"), ("_END", "E")):
+            if name.endswith(suffix):
+                base, phase = name[:-len(suffix)], ph
+        track = TRACKS.get(base, "core%d" % core)
+        event = {"name": base.lower(), "ph": phase, "ts": ts, "pid": 0, "tid": tid(track)}
+        if phase == "i":
+            event["s"] = "t"
+        if phase != "E":
+            event["args"] = {"arg": arg}
+        trace.append(event)
+    return trace, timed
+
+
+def press_to_pixel(timed):
+    """Accepted edge to the end of the first flush after the render it caused."""
+    latencies = []
+    edge = None
+    state = None
+    rendered = False
+    for ts, name, _, _ in timed:
+        if name == "BUTTON_ACCEPT":
+            edge = ts
+        elif name == "STATE" and edge is not None:
+            state, rendered = edge, False
+        elif name == "RENDER_END" and state is not None:
+            rendered = True
+        elif name == "FLUSH_END" and state is not None and rendered:
+            latencies.append(ts - state)
+            edge = state = None
+    return latencies
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("source", help="serial port or saved dump")
+    parser.add_argument("--header", default=DEFAULT_HEADER, help="trace.h to take event names from")
+    args = parser.parse_args()
+
+    if stat.S_ISCHR(os.stat(args.source).st_mode):
+        data = read_port(args.source)
+    else:
+        with open(args.source, "rb") as f:
+            data = f.read()
+
+    trace, timed = decode(data, load_events(args.header))
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, sys.stdout)
+    sys.stdout.write("\n")
+
+    latencies = press_to_pixel(timed)
+    if latencies:
+        print("press-to-pixel: %d samples, min %.1f ms, avg %.1f ms, max %.1f ms" % (
+            len(latencies), min(latencies) / 1000, sum(latencies) / len(latencies) / 1000,
+            max(latencies) / 1000), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()